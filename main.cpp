@@ -6,10 +6,22 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include <atomic>
 #include <glm/gtx/string_cast.hpp>
 #include "utils/model.hpp"
 #include "utils/camera.hpp"
 #include "utils/collision.hpp"
+#include "utils/stepper.hpp"
+#include "utils/islands.hpp"
+#include "utils/sdf.hpp"
+#include "utils/solver.hpp"
+#include "utils/ccd.hpp"
+#include "utils/physics_thread.hpp"
+#include "utils/lights.hpp"
+#include "utils/shadow.hpp"
+#include "utils/bench.hpp"
+#include "utils/gpu_profiler.hpp"
+#include "utils/profiler.hpp"
 
 #define PI glm::pi<float>()
 #define RANDOM 1
@@ -18,6 +30,7 @@
 #define DAMPING 0.95f
 #define CORRECTION_FORCE 1.0f
 #define PHYSICS_SCALE 1.0f
+#define QUAKE_SAMPLE_RATE 60.0f // amostras do tremor por segundo simulado
 
 using namespace std;
 
@@ -25,12 +38,15 @@ glm::vec3 cameraPositionBase = glm::vec3(0.0f, 0.0f, 200.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-static GLfloat AMPLITUDE = 1.5f;
-static GLfloat FREQUENCY = 2.5f;
+// ajustados pelo teclado na thread de desenho e lidos pela thread da física
+static std::atomic<GLfloat> AMPLITUDE = 1.5f;
+static std::atomic<GLfloat> FREQUENCY = 2.5f;
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+const float Z_NEAR = 0.1f;
+const float Z_FAR = 1000.0f;
 
 // timing
 float deltaTime = 0.0f; // time between current frame and last frame
@@ -42,6 +58,12 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// debug
+bool showAABBOverlay = false;  // F1
+bool printGpuTable = false;    // P
+bool toggleCpuTrace = false;   // T: inicia/encerra a captura do trace da CPU
+bool pickRequested = false;    // R: raio da câmera contra os triângulos
+
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
@@ -108,56 +130,238 @@ glm::vec3 modelRotationQuake(GLfloat time)
     return glm::vec3(0.0f, yRotation, 0.0f);
 }
 
-void applyForce(Model& m, const glm::vec3& force, GLfloat dt) {
-    glm::vec3 acceleration = force / m.object.mass;
-    m.object.velocity += acceleration * dt;
+// Espalha luzes pontuais coloridas pela sala (stress test da iluminação clusterizada)
+void addRoomLights(LightClusterGrid& grid, const AABB& room, int count) {
+    for (int i = 0; i < count; i++) {
+        PointLight light;
+        light.position = glm::vec3(
+            randomFloat(room.min_corner.x, room.max_corner.x),
+            randomFloat(room.min_corner.y, room.max_corner.y),
+            randomFloat(room.min_corner.z, room.max_corner.z)
+        );
+        light.radius = randomFloat(10.0f, 25.0f);
+        light.color = glm::vec3(randomFloat(0.2f, 1.0f), randomFloat(0.2f, 1.0f), randomFloat(0.2f, 1.0f));
+        light.intensity = 0.8f;
+        grid.lights.push_back(light);
+    }
 }
 
-void applyGravity(Model& m, GLfloat dt) {
-    // A gravidade afeta a velocidade na direção Y
-    glm::vec3 gravityForce = m.object.mass * GRAVITY;  
-    glm::vec3 gravityAcceleration = gravityForce / m.object.mass; // A = F/m
-    m.object.velocity += gravityAcceleration * dt;  // Aplique a aceleração da gravidade na velocidade
+// Cópias de um modelo em grade dentro da sala (stress test da física)
+void addExtraBodies(vector<Model>& models, const Model& source, int count, const AABB& room) {
+    const float spacing = 10.0f;
+    int perRow = glm::max(1, (int)((room.max_corner.x - room.min_corner.x) / spacing) - 1);
+    int perColumn = glm::max(1, (int)((room.max_corner.z - room.min_corner.z) / spacing) - 1);
+
+    for (int i = 0; i < count; i++) {
+        int layer = i / (perRow * perColumn);
+        int cell = i % (perRow * perColumn);
+        glm::vec3 position(
+            room.min_corner.x + spacing * (1 + cell % perRow),
+            room.min_corner.y + spacing * (1 + layer),
+            room.min_corner.z + spacing * (1 + cell / perRow)
+        );
+
+        Model copy = source;
+        copy.attachBody(*source.body.world, source.body.mass());
+        copy.translate(position - copy.getPosition());
+        models.push_back(copy);
+    }
 }
 
-
 int main(int argc, char *argv[])
 {
-    if (!glfwInit())
-    {
-        cerr << "Erro inicialicando GLFW" << endl;
-        return -1;
+    int extraLights = 0;
+    bool gpuProfileDump = false;
+    bool gpuPerDraw = false;
+    string tracePath;
+    bool bvhStats = false;
+    BroadphaseType broadphaseType = BROADPHASE_SAP;
+    NarrowphaseMode narrowphaseMode = NARROWPHASE_OBB;
+    int bvhWidth = 4;
+    int narrowphaseThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int extraBodies = 0;
+    ContactMode contactMode = CONTACT_HULLS;
+    TraversalCache traversalCache;
+    FixedStepper stepper;
+    IslandSleep islandSleep;
+    ContactSolver solver;
+    ContinuousCollision ccd;
+    bool useSceneField = true;
+    PhysicsThread physicsThread;
+    BenchOptions bench;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--lights" && i + 1 < argc)
+            extraLights = atoi(argv[++i]);
+        else if (arg == "--bench")
+            bench.enabled = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            bench.frames = atoi(argv[++i]);
+        else if (arg == "--report" && i + 1 < argc)
+            bench.reportPath = argv[++i];
+        else if (arg == "--gpu-profile")
+            gpuProfileDump = true;
+        else if (arg == "--gpu-per-draw")
+            gpuPerDraw = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--bvh-stats")
+            bvhStats = true;
+        else if (arg == "--broadphase" && i + 1 < argc)
+        {
+            if (!Broadphase::parseType(argv[++i], broadphaseType))
+                cerr << "Broadphase desconhecida: " << argv[i] << " (usando sap)" << endl;
+        }
+        else if (arg == "--narrowphase" && i + 1 < argc)
+        {
+            if (!parseNarrowphaseMode(argv[++i], narrowphaseMode))
+                cerr << "Narrowphase desconhecida: " << argv[i] << " (usando obb)" << endl;
+        }
+        else if (arg == "--bvh-width" && i + 1 < argc)
+        {
+            if (!parseBVHWidth(argv[++i], bvhWidth))
+                cerr << "Largura de BVH desconhecida: " << argv[i] << " (usando 4)" << endl;
+        }
+        else if (arg == "--no-traversal-cache")
+            traversalCache.enabled = false;
+        else if (arg == "--contacts" && i + 1 < argc)
+        {
+            if (!parseContactMode(argv[++i], contactMode))
+                cerr << "Modo de contato desconhecido: " << argv[i] << " (usando hull)" << endl;
+        }
+        else if (arg == "--physics-rate" && i + 1 < argc)
+        {
+            if (!stepper.setRate(atof(argv[++i])))
+                cerr << "Taxa da física inválida: " << argv[i] << " (usando " << stepper.rate() << " Hz)" << endl;
+        }
+        else if (arg == "--narrowphase-threads" && i + 1 < argc)
+        {
+            int threads = atoi(argv[++i]);
+            if (threads > 0)
+                narrowphaseThreads = threads;
+            else
+                cerr << "Número de threads inválido: " << argv[i] << " (usando " << narrowphaseThreads << ")" << endl;
+        }
+        else if (arg == "--bench-bodies" && i + 1 < argc)
+        {
+            // só a integração, sem contexto GL nem modelos
+            benchRigidBodies(max(1, atoi(argv[++i])));
+            return 0;
+        }
+        else if (arg == "--extra-bodies" && i + 1 < argc)
+            extraBodies = max(0, atoi(argv[++i]));
+        else if (arg == "--no-physics-thread")
+            physicsThread.threaded = false;
+        else if (arg == "--no-sleep")
+            islandSleep.enabled = false;
+        else if (arg == "--solver-iterations" && i + 1 < argc)
+        {
+            int iterations = atoi(argv[++i]);
+            if (iterations > 0)
+                solver.iterations = iterations;
+            else
+                cerr << "Número de iterações inválido: " << argv[i] << " (usando " << solver.iterations << ")" << endl;
+        }
+        else if (arg == "--no-warm-start")
+            solver.warmStart = false;
+        else if (arg == "--ccd")
+            ccd.enabled = true;
+        else if (arg == "--no-sdf")
+            useSceneField = false;
+        else if (arg == "--amplitude" && i + 1 < argc)
+        {
+            float amplitude = atof(argv[++i]);
+            if (amplitude >= 0.0f)
+                AMPLITUDE = amplitude;
+            else
+                cerr << "Amplitude inválida: " << argv[i] << " (usando " << AMPLITUDE << ")" << endl;
+        }
+        else if (arg == "--max-substeps" && i + 1 < argc)
+        {
+            int maxSubSteps = atoi(argv[++i]);
+            if (maxSubSteps > 0)
+                stepper.maxSubSteps = maxSubSteps;
+            else
+                cerr << "Limite de passos inválido: " << argv[i] << " (usando " << stepper.maxSubSteps << ")" << endl;
+        }
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // com --trace a captura cobre toda a execução, incluindo o carregamento
+    Profiler& profiler = Profiler::instance();
+    profiler.setThreadName("main");
+    profiler.enabled = !tracePath.empty();
+
+    // benchmark reproduzível: mesma semente, mesmo caminho de câmera, mesmo passo
+    if (bench.enabled)
+        srand(BENCH_SEED);
 
-    GLFWwindow *window = glfwCreateWindow(800, 500, "Projeto Final", nullptr, nullptr);
+    GLFWwindow *window = nullptr;
+    bool headless = false;
 
-    if (!window)
+#ifdef HAVE_EGL
+    HeadlessContext headlessContext;
+    if (bench.enabled)
+        headless = headlessContext.create();
+#endif
+
+    if (!headless)
     {
-        glfwTerminate();
-        cout << "Erro ao criar janela" << endl;
-        return -1;
-    }
+        if (!glfwInit())
+        {
+            cerr << "Erro inicialicando GLFW" << endl;
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        // sem EGL o benchmark usa uma janela oculta (ex.: xvfb-run em CI)
+        if (bench.enabled)
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
-    glfwMakeContextCurrent(window);
+        window = glfwCreateWindow(800, 500, "Projeto Final", nullptr, nullptr);
 
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+        if (!window)
+        {
+            glfwTerminate();
+            cout << "Erro ao criar janela" << endl;
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+
+        if (!bench.enabled)
+        {
+            glfwSetCursorPosCallback(window, mouse_callback);
+            glfwSetScrollCallback(window, scroll_callback);
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            // tell GLFW to capture our mouse
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        }
+    }
 
     glewExperimental = GL_TRUE;
     // Initialize GLEW
-    if (glewInit() != GLEW_OK)
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW reclama da falta de display GLX em contextos EGL, mas carrega as funções GL
+    if (headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)
+        glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK)
     {
         cerr << "ERROR: GLEW Initialization Failed\n";
         return -1;
     }
 
+    OffscreenTarget offscreen;
+    if (bench.enabled && !offscreen.init(BENCH_WIDTH, BENCH_HEIGHT))
+    {
+        cerr << "Erro: framebuffer do benchmark incompleto" << endl;
+        return -1;
+    }
+
     glEnable(GL_DEPTH_TEST);
 
     Light ambient;
@@ -168,59 +372,81 @@ int main(int argc, char *argv[])
     string vertexPath = "shaders/vertex.shader";
     string fragmentPath = "shaders/fragment.shader";
 
-    Model scene("data/room/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m1("data/table/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m2("data/lampshader/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m3("data/book2/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m4("data/book1/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m5("data/bed/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m6("data/nightstand/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
-    Model m7("data/bulb/source/model.obj", vertexPath.c_str(), fragmentPath.c_str());
+    // leitura e BVHs em paralelo; texturas e buffers na thread do contexto
+    vector<ModelData> modelData = loadModelsParallel({
+        "data/room/source/model.obj",
+        "data/table/source/model.obj",
+        "data/lampshader/source/model.obj",
+        "data/book2/source/model.obj",
+        "data/book1/source/model.obj",
+        "data/bed/source/model.obj",
+        "data/nightstand/source/model.obj",
+        "data/bulb/source/model.obj"
+    });
+
+    Model scene(std::move(modelData[0]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m1(std::move(modelData[1]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m2(std::move(modelData[2]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m3(std::move(modelData[3]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m4(std::move(modelData[4]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m5(std::move(modelData[5]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m6(std::move(modelData[6]), vertexPath.c_str(), fragmentPath.c_str());
+    Model m7(std::move(modelData[7]), vertexPath.c_str(), fragmentPath.c_str());
+
+    // corpos rígidos dos móveis; a sala é estática
+    RigidBodyWorld world;
 
     // posicionando elementos
     // ------------------ SALA ------------------
     scene.scale(glm::vec3(50.0f));
 
     // ------------------ MESA ------------------
-    m1.setModelMass(30.0f);
+    m1.attachBody(world, 30.0f);
     m1.translate(glm::vec3(-30.0f, -40.0f, -35.0f));
     m1.scale(glm::vec3(20.0f));
 
     // ------------------ ABAJUR ------------------
-    m2.setModelMass(3.0f);
+    m2.attachBody(world, 3.0f);
     m2.translate(glm::vec3(-38.0f, -23.0f, -35.0f));
     m2.scale(glm::vec3(7.0f));
 
     // ------------------ LIVRO 1 ------------------
-    m3.setModelMass(0.3f);
+    m3.attachBody(world, 0.3f);
     m3.translate(glm::vec3(-20.0f, -27.5f, -34.0f));
     m3.rotate(90.0f, glm::vec3(1.0f, 0.0f, 0.0));
     m3.scale(glm::vec3(5.0f));
 
     // ------------------ CAMA ------------------
-    m5.setModelMass(45.0f);
+    m5.attachBody(world, 45.0f);
     m5.translate(glm::vec3(32.0f, -35.0f, -20.0f));
     m5.scale(glm::vec3(30.0f, 32.0f, 18.0f));
 
     // ------------------ CRIADO MUDO ------------------
-    m6.setModelMass(15.6);
+    m6.attachBody(world, 15.6f);
     m6.translate(glm::vec3(-38.0f, -40.0f, 30.0f));
     m6.rotate(90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     m6.scale(glm::vec3(10.0f));
 
     // ------------------ LIVRO 2 (empilhado) ------------------
-    m4.setModelMass(0.5f);
+    m4.attachBody(world, 0.5f);
     m4.translate(glm::vec3(-38.0f, -36.5f, 30.0f));
     m4.rotate(30.0f, glm::vec3(0.0f, 1.0f, 0.0));
     m4.scale(glm::vec3(5.0f));
 
+    if (bvhStats)
+    {
+        cout << "BVH das malhas:" << endl;
+        for (const Model *model : {&scene, &m1, &m2, &m3, &m4, &m5, &m6, &m7})
+            model->printBVHStats();
+    }
+
     glm::mat4 view;
 
     glm::mat4 projection = glm::perspective(
         glm::radians(45.0f),
         800.0f / 500.0f,
-        0.1f,
-        1000.0f);
+        Z_NEAR,
+        Z_FAR);
 
     models.push_back(m1);
     models.push_back(m2);
@@ -231,103 +457,433 @@ int main(int argc, char *argv[])
 
     bool firstFrame = true;
     AABB scene_AABB = scene.getGlobalAABB();
-    while (!glfwWindowShouldClose(window))
+
+    // paredes, piso e teto pelo campo de distância da sala, na pose sem tremor
+    // (como scene_AABB); --no-sdf volta à caixa de checkCollisionWithSceneBounds
+    glm::mat4 sceneMatrix = scene.modelMatrix();
+    SignedDistanceField sceneField;
+    vector<SceneContact> sceneContacts;
+    if (useSceneField)
     {
-        GLfloat currentFrame = static_cast<GLfloat>(glfwGetTime());
+        StopWatch fieldWatch;
+        sceneField = loadOrBuildSignedDistanceField("data/room/source/model.obj", scene.meshes, narrowphaseThreads);
+        sceneField.solidOutside = true;
+        cout << "Campo de distância da sala: " << sceneField.fineBricks() << " de " << sceneField.coarse.size()
+             << " blocos na faixa (" << fieldWatch.elapsedMs() << " ms)" << endl;
+    }
+    addExtraBodies(models, m4, extraBodies, scene_AABB);
+
+    Broadphase broadphase;
+    broadphase.type = broadphaseType;
+    bench.broadphase = broadphase.name();
+    bench.narrowphase = narrowphaseModeName(narrowphaseMode);
+    bench.bvhWidth = bvhWidth;
+    bench.contacts = contactModeName(contactMode);
+    bench.traversalCache = traversalCache.enabled;
+    bench.physicsRate = stepper.rate();
+    bench.maxSubSteps = stepper.maxSubSteps;
+    bench.physicsThread = physicsThread.threaded;
+    bench.extraBodies = extraBodies;
+    bench.sleep = islandSleep.enabled;
+    bench.solverIterations = solver.iterations;
+    bench.warmStart = solver.warmStart;
+    bench.ccd = ccd.enabled;
+    bench.sceneField = useSceneField;
+    bench.amplitude = AMPLITUDE;
+
+    ParallelNarrowphase narrowphase(narrowphaseThreads);
+    bench.narrowphaseThreads = narrowphase.threads();
+    if (bvhWidth > 2)
+        cout << "BVH de " << bvhWidth << " filhos (SIMD: " << simdLevelName(wideBVHKernel(bvhWidth)) << ")" << endl;
+    vector<AABB> bodyBounds(models.size());
+    vector<BroadphasePair> activePairs;  // pares com pelo menos um corpo acordado
+
+    // ------------------ LUZES ------------------
+    LightClusterGrid lightGrid;
+    lightGrid.init();
+
+    PointLight lampLight;  // luz do abajur, acompanha o modelo
+    lampLight.radius = 45.0f;
+    lampLight.color = glm::vec3(1.0f, 0.85f, 0.6f);
+    lampLight.intensity = 1.5f;
+    lightGrid.lights.push_back(lampLight);
+
+    addRoomLights(lightGrid, scene_AABB, extraLights);
+
+    // ------------------ SOMBRAS ------------------
+    ShadowMap shadowMap;
+    shadowMap.init();
+
+    GpuProfiler gpuProfiler;
+    gpuProfiler.perDraw = gpuPerDraw;
+    gpuProfiler.init();
+
+    BenchStats benchStats;
+    GLuint gpuTimer = 0;
+    if (bench.enabled)
+        glGenQueries(1, &gpuTimer);
+
+    // ------------------ FÍSICA ------------------
+    // Tudo abaixo roda na thread da física: só ela toca transforms, object e
+    // effect dos modelos; o desenho lê apenas o que foi publicado em snapshots.
+    long quakeSample = -1;
+    glm::vec3 lastShakeOffset(0.0f);
+
+    vector<float> bodySpin(world.size());
+    vector<BodyState> bodyStates(models.size() + 1);  // 0 é a sala
+    bodyStates[0].capture(scene);
+    bodyStates[0].capture(scene);
+    for (int i = 0; i < models.size(); i++)
+    {
+        bodyStates[i + 1].capture(models[i]);
+        bodyStates[i + 1].capture(models[i]);
+    }
+
+    TripleBuffer<PhysicsSnapshot> snapshots;
+    snapshots.writeBuffer().bodies = bodyStates;
+    snapshots.publish();
+
+    // lido pela thread de desenho só depois de physicsThread.wait()
+    struct {
+        double ms = 0.0;
+        int subSteps = 0;
+        double nodeTests = 0.0;
+        int pairs = 0;
+        double narrowphaseMs = 0.0;
+        int awakeBodies = 0;
+        int contactPoints = 0;
+        int ccdClamped = 0;
+        int ccdCapped = 0;
+    } physicsStats;
+
+    auto physicsFrame = [&](double frameTime)
+    {
+        PROFILE_SCOPE("physics");
+        StopWatch physicsWatch;
+
+        physicsStats.subSteps = stepper.advance(frameTime);
+        physicsStats.nodeTests = 0.0;
+        physicsStats.narrowphaseMs = 0.0;
+        physicsStats.ccdClamped = 0;
+        physicsStats.ccdCapped = 0;
+
+        for (int step = 0; step < physicsStats.subSteps; step++)
+        {
+            PROFILE_SCOPE("physics step");
+            GLfloat dt = (GLfloat)stepper.step;
+            GLfloat simTime = (GLfloat)stepper.time;
+            GLfloat referenceFrames = dt * PHYSICS_REFERENCE_RATE; // fração de um frame de 60 Hz
+
+            // 1. Deslocamento do terremoto, amostrado a 60 Hz independente da taxa da física
+            glm::vec3 groundVelocity(0.0f);
+            long sample = (long)(stepper.time * QUAKE_SAMPLE_RATE);
+            if (sample != quakeSample)
+            {
+                glm::vec3 currentShakeOffset = modelQuake(simTime);
+                if (quakeSample >= 0)
+                    groundVelocity = (currentShakeOffset - lastShakeOffset) / dt;
+                lastShakeOffset = currentShakeOffset;
+                quakeSample = sample;
+
+                scene.clearEffect();
+                scene.applyEffect(TRANSLATE, currentShakeOffset);
+            }
+
+            {
+                PROFILE_SCOPE("integrate");
+
+                // giro do tremor por corpo, sorteado na ordem dos modelos
+                float maxSpin = 0.0f;
+                for (const Model &model: models)
+                {
+                    bodySpin[model.body.index] = modelRotationQuake(simTime).y;
+                    maxSpin = glm::max(maxSpin, glm::abs(bodySpin[model.body.index]));
+                }
+
+                BodyStepInput input;
+                input.acceleration = GRAVITY + groundVelocity * 0.06f + modelSpeedQuake(simTime) * 50.0f;
+                input.dt = dt;
+                input.spin = bodySpin.data();
+                input.spinScale = referenceFrames;
+                input.torqueScale = 0.05f * referenceFrames;
+                input.linearDamping = stepper.perStep(DAMPING);
+                input.linearRest = 0.01f;
+                input.angularRest = 0.01f * PHYSICS_REFERENCE_RATE;
+
+                // chão se mexendo acorda todo mundo; parado, só os acordados integram
+                glm::vec3 quakeAcceleration = input.acceleration - GRAVITY;
+                if (glm::length(quakeAcceleration) > SLEEP_WAKE_ACCELERATION || maxSpin > SLEEP_WAKE_SPIN)
+                    islandSleep.wakeAll(world);
+                ccd.begin(models);
+                integrateBodies(world, input);
+
+                for (Model &model: models)
+                {
+                    if (model.body.sleeping()) continue;
+                    model.syncBody();
+                    if (!useSceneField)
+                        checkCollisionWithSceneBounds(model, scene_AABB);
+                }
+            }
+
+            {
+                PROFILE_SCOPE("collisions");
+
+                // corpos que andaram mais que o próprio tamanho voltam ao primeiro impacto
+                ccd.run(models, broadphase.tree, bvhWidth, contactMode);
+                physicsStats.ccdClamped += ccd.clamped;
+                physicsStats.ccdCapped += ccd.capped;
+
+                // todos, não só os acordados: a correção de posição do passo
+                // anterior pode ter movido um corpo que dormiu logo depois
+                for (int i = 0; i < models.size(); i++)
+                    bodyBounds[i] = models[i].getWorldAABB();
+
+                // só os pares com caixas sobrepostas descem para as BVHs das
+                // malhas, e só se algum dos dois estiver acordado; os pares
+                // dormindo mantêm a frente em cache para quando acordarem
+                activePairs.clear();
+                for (const BroadphasePair &pair: broadphase.update(bodyBounds))
+                {
+                    if (!models[pair.a].body.sleeping() || !models[pair.b].body.sleeping())
+                        activePairs.push_back(pair);
+                    else
+                        traversalCache.touch(models[pair.a], models[pair.b]);
+                }
+                narrowphase.run(models, activePairs, narrowphaseMode, bvhWidth, contactMode, &traversalCache);
+                physicsStats.narrowphaseMs += narrowphase.detectMs;
+
+                // todos os contatos do passo resolvidos juntos, os da sala inclusive
+                sceneFieldContacts(sceneField, sceneMatrix, models, sceneContacts);
+                solver.solve(models, activePairs, narrowphase.contacts(), sceneContacts);
+                physicsStats.contactPoints = solver.points;
+
+                // ilhas pelos contatos deste passo; as quietas dormem
+                islandSleep.begin(world.size());
+                for (const PairContact &contact: narrowphase.contacts())
+                {
+                    const BroadphasePair &pair = activePairs[contact.pair];
+                    islandSleep.unite(models[pair.a].body.index, models[pair.b].body.index);
+                }
+                islandSleep.update(world, dt);
+                physicsStats.awakeBodies = world.awakeCount();
+
+                // descarta as frentes dos pares que se separaram
+                traversalCache.endStep();
+                physicsStats.nodeTests += traversalCache.lastStep.nodeTests;
+                physicsStats.pairs = (int)broadphase.pairs().size();
+            }
+
+            stepper.time += stepper.step;
+            bodyStates[0].capture(scene);
+            for (int i = 0; i < models.size(); i++)
+                bodyStates[i + 1].capture(models[i]);
+        }
+
+        PhysicsSnapshot &snapshot = snapshots.writeBuffer();
+        snapshot.bodies = bodyStates;
+        snapshot.alpha = stepper.alpha();
+        snapshots.publish();
+
+        physicsStats.ms = physicsWatch.elapsedMs();
+    };
+    physicsThread.start(physicsFrame);
+
+    int frameCount = 0;
+    while (bench.enabled ? frameCount < bench.frames : !glfwWindowShouldClose(window))
+    {
+        PROFILE_SCOPE("frame");
+        StopWatch frameWatch;
+
+        // no benchmark o tempo avança em passos fixos, independente do relógio
+        GLfloat currentFrame = bench.enabled ? frameCount * BENCH_TIMESTEP : static_cast<GLfloat>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        processInput(window);
-
-        // 1. Cálculo do deslocamento do terremoto
-        static glm::vec3 lastShakeOffset(0.0f);
-        glm::vec3 currentShakeOffset = modelQuake(currentFrame);
-        glm::vec3 shakeDelta = currentShakeOffset - lastShakeOffset;
-        lastShakeOffset = currentShakeOffset;
-
-        scene.clearEffect();
-        scene.applyEffect(TRANSLATE, currentShakeOffset);
+        if (bench.enabled)
+            benchCameraPath(camera, currentFrame);
+        else
+            processInput(window);
 
         view = camera.GetViewMatrix();
 
-        glm::vec3 groundVelocity(0.0f);
-        if (!firstFrame) {
-            groundVelocity = deltaTime > 0.0f ? shakeDelta / deltaTime : glm::vec3(0.0f);
+        // desenho entre os dois últimos passos publicados pela física
+        if (snapshots.update())
+        {
+            const PhysicsSnapshot &snapshot = snapshots.readBuffer();
+            scene.renderMatrix = snapshot.bodies[0].interpolate(snapshot.alpha);
+            for (int i = 0; i < models.size(); i++)
+                models[i].renderMatrix = snapshot.bodies[i + 1].interpolate(snapshot.alpha);
         }
 
-        for (Model &model: models)
-        {
-            if (!firstFrame) {
-                applyGravity(model, deltaTime);
+        // a física deste frame corre enquanto o desenho usa o estado do anterior;
+        // no benchmark o passo de frame é exato, então o número de passos é fixo
+        physicsThread.submit(firstFrame ? 0.0 : (bench.enabled ? BENCH_TIMESTEP : deltaTime));
 
-                glm::vec3 shakeForce = groundVelocity * model.object.mass * 0.06f;
-                applyForce(model, shakeForce, deltaTime);
-                
-                glm::vec3 quakeSpeed = modelSpeedQuake(currentFrame);
-                // Aplique esse deslocamento no modelo
-                model.object.velocity += quakeSpeed * deltaTime * 50.0f; // Aplique a velocidade de tremor
-                glm::vec3 modelQuakeDisplacement = model.object.velocity * deltaTime; // Aplique a movimentação
+        lightGrid.lights[0].position = glm::vec3(models[1].renderMatrix[3]) + glm::vec3(0.0f, 5.0f, 0.0f);
 
-                model.translate(modelQuakeDisplacement);  // Atualize a posição do modelo com a nova velocidade
+        if (bench.enabled)
+            glBeginQuery(GL_TIME_ELAPSED, gpuTimer);
 
-                // Rotações devido ao tremor
-                glm::vec3 quakeRotation = modelRotationQuake(currentFrame);
-                model.rotate(quakeRotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-                // model.rotate(quakeRotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+        gpuProfiler.beginFrame(frameCount);
 
-                glm::vec3 torque = quakeRotation * model.object.mass * 0.05f;
-                model.object.angularVelocity += torque * deltaTime;
+        {
+            PROFILE_SCOPE("lights");
+            GpuScope lightsScope(gpuProfiler, "lights");
+            lightGrid.update(view, projection, Z_NEAR, Z_FAR);
+        }
 
-                model.object.angularVelocity *= model.object.angularDamping;
-            }
+        {
+            PROFILE_SCOPE("shadows");
+            GpuScope shadowScope(gpuProfiler, "shadows");
 
-            // Atualizar a rotação com base no torque
-            model.rotate(model.object.angularVelocity.y, glm::vec3(0.0f, 1.0f, 0.0f));
+            // sala estática só é redesenhada no shadow map quando a luz se move
+            if (shadowMap.beginStaticPass(ambient.position))
+                scene.drawDepth(shadowMap.depthShader, false);
 
-            // Aplicar atrito após o movimento
-            if (glm::length(model.object.velocity) < 0.01f)
-                model.object.velocity = glm::vec3(0.0f);
-            else
-                model.object.velocity *= 0.95f; // ou outro valor ajustável
+            shadowMap.beginDynamicPass();
+            for (const Model &model : models)
+                model.drawDepth(shadowMap.depthShader, true);
+            shadowMap.endPass();
+        }
 
-            // Aplicar damping no torque
-            if (glm::length(model.object.angularVelocity) < 0.01f)
-                model.object.angularVelocity = glm::vec3(0.0f);  // Se a rotação for muito baixa, zere
-            else
-                model.object.angularVelocity *= model.object.angularDamping;  // Aplica o damping para diminuir a rotação
+        {
+            PROFILE_SCOPE("models");
+            GpuScope modelsScope(gpuProfiler, "models");
+            for (Model &model : models)
+            {
+                GpuScope drawScope(gpuProfiler, model.name.c_str(), gpuProfiler.perDraw);
+                model.draw(view, projection, ambient.position, ambient.color, camera.Position, false, &lightGrid, &shadowMap);
+            }
+        }
 
+        {
+            PROFILE_SCOPE("scene");
+            GpuScope sceneScope(gpuProfiler, "scene");
+            scene.draw(view, projection, ambient.position, ambient.color, camera.Position, false, &lightGrid, &shadowMap);
+        }
+
+        if (showAABBOverlay)
+        {
+            GpuScope overlayScope(gpuProfiler, "aabb overlay");
+            for (const Model &model : models)
+                model.drawBoundingTrees(view, projection);
+        }
 
-            checkCollisionWithSceneBounds(model, scene_AABB);
+        if (printGpuTable)
+        {
+            gpuProfiler.printTable();
+            printGpuTable = false;
         }
 
-        for (int i = 0; i < models.size(); i++)
+        if (pickRequested)
         {
-            for (int j = i + 1; j < models.size(); j++)
+            pickRequested = false;
+            const Model* picked = nullptr;
+            float distance = FLT_MAX;
+            for (const Model &model : models)
+                if (model.raycast(camera.Position, camera.Front, distance, bvhWidth))
+                    picked = &model;
+            if (scene.raycast(camera.Position, camera.Front, distance, bvhWidth))
+                picked = &scene;
+
+            if (picked)
+                cout << "Mira: " << picked->name << " a " << distance << endl;
+            else
+                cout << "Mira: nada" << endl;
+        }
+
+        if (toggleCpuTrace)
+        {
+            toggleCpuTrace = false;
+            if (!profiler.enabled)
+            {
+                profiler.enabled = true;
+                cout << "Capturando trace da CPU (T para salvar)" << endl;
+            }
+            else
             {
-                handleModelCollisionPrecise(models[i], models[j]);
+                profiler.enabled = false;
+                if (profiler.writeChromeTrace(tracePath.empty() ? "trace.json" : tracePath, &gpuProfiler))
+                    cout << "Trace salvo em " << (tracePath.empty() ? "trace.json" : tracePath) << endl;
+                profiler.clear();
             }
+        }
 
-            models[i].draw(view, projection, ambient.position, ambient.color, camera.Position);
+        // a próxima leitura de snapshots e de physicsStats depende deste frame completo
+        {
+            PROFILE_SCOPE("wait physics");
+            physicsThread.wait();
         }
 
-        scene.draw(view, projection, ambient.position, ambient.color, camera.Position);
+        if (bench.enabled)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+
+            // serializa CPU e GPU para que o tempo de frame inclua o trabalho da GPU
+            glFinish();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            GLuint64 gpuNs = 0;
+            glGetQueryObjectui64v(gpuTimer, GL_QUERY_RESULT, &gpuNs);
+            benchStats.addFrame(frameCount, frameWatch.elapsedMs(), physicsStats.ms, gpuNs / 1.0e6, physicsStats.pairs, physicsStats.nodeTests, physicsStats.subSteps, physicsStats.narrowphaseMs, physicsStats.awakeBodies, physicsStats.contactPoints, physicsStats.ccdClamped, physicsStats.ccdCapped, lightGrid.droppedLights);
+        }
+        else
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
 
         firstFrame = false;
+        frameCount++;
+    }
+
+    physicsThread.stop();
+
+    if (bench.enabled)
+    {
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        benchStats.cacheHitRate = traversalCache.total.hitRate();
+        benchStats.warmStartRate = solver.warmStartRate();
+        benchStats.printSummary();
+        if (benchStats.writeReport(bench, renderer ? renderer : "unknown"))
+            cout << "Relatório salvo em " << bench.reportPath << endl;
+
+        glDeleteQueries(1, &gpuTimer);
+        offscreen.destroy();
     }
 
+    if (gpuProfileDump)
+    {
+        gpuProfiler.flush();
+        if (gpuProfiler.writeCsv("gpu_profile.csv") && gpuProfiler.writeChromeTrace("gpu_trace.json"))
+            cout << "Perfil da GPU salvo em gpu_profile.csv e gpu_trace.json" << endl;
+    }
+    if (!tracePath.empty())
+    {
+        profiler.enabled = false;
+        if (profiler.writeChromeTrace(tracePath, &gpuProfiler))
+            cout << "Trace salvo em " << tracePath << endl;
+    }
+    gpuProfiler.destroy();
+
+    lightGrid.destroy();
+    shadowMap.destroy();
     scene.destroy();
     for (Model &model : models)
     {
         model.destroy();
     }
 
-    glfwTerminate();
+#ifdef HAVE_EGL
+    if (headless)
+        headlessContext.destroy();
+#endif
+    if (window)
+        glfwTerminate();
     return 0;
 }
 
@@ -344,23 +900,44 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
-        AMPLITUDE += 0.1f;
-        AMPLITUDE = glm::min(AMPLITUDE, 2.5f);
+        AMPLITUDE = glm::min(AMPLITUDE + 0.1f, 2.5f);
     }
     if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
     {
-        AMPLITUDE -= 0.1f;
-        AMPLITUDE = glm::max(AMPLITUDE, 0.0f);
+        AMPLITUDE = glm::max(AMPLITUDE - 0.1f, 0.0f);
     }
     if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
-        FREQUENCY += 0.1f;
-        FREQUENCY = glm::min(FREQUENCY, 2.5f);
+        FREQUENCY = glm::min(FREQUENCY + 0.1f, 2.5f);
     }
     if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS)
     {
-        FREQUENCY -= 0.1f;
-        FREQUENCY = glm::max(FREQUENCY, 0.0f);
+        FREQUENCY = glm::max(FREQUENCY - 0.1f, 0.0f);
     }
+
+    // teclas de alternância: só reagem na borda de descida
+    static bool overlayKeyDown = false;
+    bool overlayKey = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (overlayKey && !overlayKeyDown)
+        showAABBOverlay = !showAABBOverlay;
+    overlayKeyDown = overlayKey;
+
+    static bool gpuKeyDown = false;
+    bool gpuKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (gpuKey && !gpuKeyDown)
+        printGpuTable = true;
+    gpuKeyDown = gpuKey;
+
+    static bool traceKeyDown = false;
+    bool traceKey = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if (traceKey && !traceKeyDown)
+        toggleCpuTrace = true;
+    traceKeyDown = traceKey;
+
+    static bool pickKeyDown = false;
+    bool pickKey = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    if (pickKey && !pickKeyDown)
+        pickRequested = true;
+    pickKeyDown = pickKey;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -3,6 +3,8 @@
 in vec2 TexCoord;
 in vec3 FragNormal;
 in vec3 FragPosition;
+in float ViewDepth;
+in vec4 FragPosLightSpace;
 
 uniform vec3 viewPosition;
 uniform vec3 lightPosition;
@@ -24,6 +26,46 @@ struct Material {
 
 uniform Material material;
 
+// iluminação clusterizada (ver utils/lights.hpp)
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
+uniform bool useClusters;
+uniform samplerBuffer clusterLights;    // 2 texels por luz: (posição, raio), (cor, intensidade)
+uniform usamplerBuffer clusterGrid;     // (offset, count) por cluster
+uniform usamplerBuffer clusterIndices;  // índices das luzes de cada cluster
+uniform vec2 clusterTileSize;
+uniform float clusterNear;
+uniform float clusterFar;
+
+// sombra da luz do teto (ver utils/shadow.hpp)
+uniform bool useShadows;
+uniform sampler2D shadowMap;
+
+float shadowFactor(vec3 normal, vec3 lightDir)
+{
+    if (FragPosLightSpace.w <= 0.0) return 0.0;  // atrás da luz
+
+    vec3 projected = FragPosLightSpace.xyz / FragPosLightSpace.w;
+    projected = projected * 0.5 + 0.5;
+
+    if (projected.z > 1.0) return 0.0;
+
+    float bias = max(0.005 * (1.0 - dot(normal, lightDir)), 0.0005);
+
+    // PCF 3x3
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            float closest = texture(shadowMap, projected.xy + vec2(x, y) * texelSize).r;
+            shadow += projected.z - bias > closest ? 1.0 : 0.0;
+        }
+    }
+    return shadow / 9.0;
+}
+
 uniform sampler2D texture1; // base color
 
 // details
@@ -68,7 +110,41 @@ void main()
 
     vec3 specular = material.specular * spec * specularStrength * lightColor;
 
-    vec3 color = ambient + diffuse + specular;
+    float shadow = useShadows ? shadowFactor(normal, lightDir) : 0.0;
+
+    vec3 color = ambient + (1.0 - shadow) * (diffuse + specular);
+
+    // Soma apenas as luzes que afetam o cluster deste fragmento
+    if (useClusters) {
+        int slice = int(floor(log(max(ViewDepth, clusterNear) / clusterNear) * float(CLUSTER_Z) / log(clusterFar / clusterNear)));
+        ivec2 tile = ivec2(gl_FragCoord.xy / clusterTileSize);
+        ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+        int clusterIndex = (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x;
+
+        uvec2 range = texelFetch(clusterGrid, clusterIndex).xy;
+        for (uint i = 0u; i < range.y; i++) {
+            int lightIndex = int(texelFetch(clusterIndices, int(range.x + i)).r);
+            vec4 positionRadius = texelFetch(clusterLights, lightIndex * 2);
+            vec4 colorIntensity = texelFetch(clusterLights, lightIndex * 2 + 1);
+
+            vec3 toLight = positionRadius.xyz - FragPosition;
+            float dist = length(toLight);
+            if (dist >= positionRadius.w) continue;
+
+            // atenuação suave que chega a zero no raio da luz
+            float falloff = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+            float attenuation = falloff * falloff * colorIntensity.w;
+
+            vec3 pointDir = toLight / dist;
+            vec3 pointColor = colorIntensity.rgb * attenuation;
+
+            float pointDiff = max(dot(normal, pointDir), 0.0);
+            float pointSpec = pow(max(dot(viewDir, reflect(-pointDir, normal)), 0.0), 32.0);
+
+            color += material.diffuse * pointColor * pointDiff;
+            color += material.specular * pointSpec * specularStrength * pointColor;
+        }
+    }
 
     if (material.hasDiffuseTexture == 1) {
         color *= texture(material.diffuseTexture, TexCoord).rgb;
@@ -7,10 +7,13 @@ layout (location = 2) in vec3 aNormal;  // Normal do vértice
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform mat4 lightSpaceMatrix;
 
 out vec2 TexCoord;
 out vec3 FragNormal;
 out vec3 FragPosition;
+out float ViewDepth;
+out vec4 FragPosLightSpace;
 
 void main()
 {
@@ -18,4 +21,6 @@ void main()
     TexCoord = aText;
     FragNormal = aNormal;
     FragPosition = vec3(model * vec4(aPos, 1.0));
+    ViewDepth = -(view * vec4(FragPosition, 1.0)).z;  // profundidade para o cluster
+    FragPosLightSpace = lightSpaceMatrix * vec4(FragPosition, 1.0);
 }
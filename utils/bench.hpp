@@ -0,0 +1,350 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include "camera.hpp"
+#include "rigid_body.hpp"
+#include "profiler.hpp"
+
+#ifdef HAVE_EGL
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+#define BENCH_DEFAULT_FRAMES 600
+#define BENCH_TIMESTEP (1.0f / 60.0f)
+#define BENCH_WARMUP 10
+#define BENCH_SEED 42
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 500
+#define BENCH_BODY_STEPS 500  // passos de integração por nível SIMD em --bench-bodies
+
+struct BenchOptions {
+    bool enabled = false;
+    int frames = BENCH_DEFAULT_FRAMES;
+    std::string reportPath = "bench_report.json";
+    std::string broadphase = "sap";
+    std::string narrowphase = "obb";
+    int bvhWidth = 4;
+    std::string contacts = "hull";
+    bool traversalCache = true;
+    float physicsRate = 120.0f;
+    int maxSubSteps = 8;
+    bool physicsThread = true;
+    int narrowphaseThreads = 1;
+    int extraBodies = 0;
+    bool sleep = true;
+    int solverIterations = 8;
+    bool warmStart = true;
+    bool ccd = false;
+    bool sceneField = true;
+    float amplitude = 1.5f;
+};
+
+// Cronômetro de parede em milissegundos
+struct StopWatch {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    void reset() { start = std::chrono::steady_clock::now(); }
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#ifdef HAVE_EGL
+// Contexto GL 3.3 sem janela nem servidor X (EGL surfaceless, ex.: Mesa llvmpipe)
+struct HeadlessContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    bool create();
+    void destroy();
+};
+
+bool HeadlessContext::create() {
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        return false;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    // sem surface: todo o desenho vai para o FBO do benchmark
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (context == EGL_NO_CONTEXT)
+        return false;
+
+    return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+void HeadlessContext::destroy() {
+    if (display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+#endif
+
+// Framebuffer de cor + profundidade usado no lugar da janela
+struct OffscreenTarget {
+    GLuint fbo = 0, color = 0, depth = 0;
+    int width = 0, height = 0;
+
+    bool init(int w, int h);
+    void destroy();
+};
+
+bool OffscreenTarget::init(int w, int h) {
+    width = w;
+    height = h;
+
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glGenRenderbuffers(1, &depth);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+    glViewport(0, 0, w, h);
+
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void OffscreenTarget::destroy() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+}
+
+// Caminho de câmera determinístico: entra na sala pela frente e varre de um lado a outro
+void benchCameraPath(Camera& camera, float t) {
+    float approach = glm::clamp(t / 4.0f, 0.0f, 1.0f);
+    glm::vec3 position = glm::mix(glm::vec3(0.0f, 0.0f, 200.0f), glm::vec3(0.0f, -10.0f, 45.0f), approach);
+
+    float yaw = -90.0f + 50.0f * glm::sin(t * 0.6f) * approach;
+    float pitch = -15.0f * approach;
+
+    camera.SetPose(position, yaw, pitch);
+}
+
+// Custo de integrateBodies com count corpos em cada nível SIMD disponível;
+// todos partem do mesmo mundo, então os números são comparáveis entre si
+void benchRigidBodies(int count) {
+    srand(BENCH_SEED);
+    auto random = [](float lo, float hi) { return lo + (hi - lo) * (float)rand() / (float)RAND_MAX; };
+
+    RigidBodyWorld world;
+    std::vector<float> spin(count);
+    for (int i = 0; i < count; i++) {
+        world.add(glm::vec3(random(-50.0f, 50.0f), random(-50.0f, 50.0f), random(-50.0f, 50.0f)), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), random(0.3f, 45.0f));
+        world.setVelocity(i, glm::vec3(random(-5.0f, 5.0f), random(-5.0f, 5.0f), random(-5.0f, 5.0f)));
+        spin[i] = random(-2.0f, 2.0f);
+    }
+
+    BodyStepInput input;
+    input.acceleration = glm::vec3(0.0f, -200.0f, 0.0f);
+    input.dt = 1.0f / 120.0f;
+    input.spin = spin.data();
+    input.spinScale = 0.5f;
+    input.torqueScale = 0.025f;
+    input.linearDamping = 0.975f;
+    input.linearRest = 0.01f;
+    input.angularRest = 0.6f;
+
+    std::cout << "Integração de " << count << " corpos (" << BENCH_BODY_STEPS << " passos)" << std::endl;
+    for (SimdLevel level : {SIMD_SCALAR, SIMD_SSE, SIMD_AVX2}) {
+        if (level > detectSimdLevel()) break;
+
+        RigidBodyWorld copy = world;
+        integrateBodies(copy, input, level);  // aquece caches
+
+        StopWatch watch;
+        for (int step = 0; step < BENCH_BODY_STEPS; step++)
+            integrateBodies(copy, input, level);
+        double stepMs = watch.elapsedMs() / BENCH_BODY_STEPS;
+
+        std::cout << "  " << std::left << std::setw(8) << simdLevelName(level) << std::right
+                  << std::fixed << std::setprecision(4) << stepMs << " ms/passo  "
+                  << std::setprecision(2) << stepMs * 1.0e6 / count << " ns/corpo" << std::endl;
+    }
+}
+
+struct BenchStats {
+    std::vector<double> frameMs;
+    std::vector<double> physicsMs;
+    std::vector<double> narrowphaseMs;  // detecção paralela dos pares
+    std::vector<double> gpuMs;
+    std::vector<double> pairCounts;  // pares candidatos da broadphase
+    std::vector<double> nodeTests;   // pares de nós testados nas BVHs
+    std::vector<double> subSteps;    // passos da física por frame
+    std::vector<double> awakeBodies; // corpos acordados ao fim do frame
+    std::vector<double> contactPoints; // pontos no solver, último passo do frame
+    std::vector<double> ccdClamps;   // corpos levados de volta ao impacto pelo CCD
+    std::vector<double> ccdCapped;   // corpos rápidos com as poses limitadas por CCD_MAX_SAMPLES
+    std::vector<double> droppedLights; // luzes cortadas de clusters cheios
+    double cacheHitRate = 0.0;       // consultas respondidas pela frente em cache
+    double warmStartRate = 0.0;      // pontos que começaram do impulso do passo anterior
+
+    void addFrame(int frame, double frameTime, double physicsTime, double gpuTime, int pairs, double nodes, int steps, double narrowphaseTime, int awake, int points, int clamps, int capped, int dropped);
+    void printSummary() const;
+    bool writeReport(const BenchOptions& options, const std::string& renderer) const;
+
+    static double percentile(std::vector<double> values, double p);
+};
+
+void BenchStats::addFrame(int frame, double frameTime, double physicsTime, double gpuTime, int pairs, double nodes, int steps, double narrowphaseTime, int awake, int points, int clamps, int capped, int dropped) {
+    // primeiros frames compilam shaders e aquecem caches
+    if (frame < BENCH_WARMUP) return;
+
+    frameMs.push_back(frameTime);
+    physicsMs.push_back(physicsTime);
+    narrowphaseMs.push_back(narrowphaseTime);
+    gpuMs.push_back(gpuTime);
+    pairCounts.push_back(pairs);
+    nodeTests.push_back(nodes);
+    subSteps.push_back(steps);
+    awakeBodies.push_back(awake);
+    contactPoints.push_back(points);
+    ccdClamps.push_back(clamps);
+    ccdCapped.push_back(capped);
+    droppedLights.push_back(dropped);
+}
+
+// percentil por ranking mais próximo
+double BenchStats::percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+    rank = std::clamp(rank, (size_t)1, values.size());
+    return values[rank - 1];
+}
+
+static std::string benchSeriesJson(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    double mean = values.empty() ? 0.0 : sum / values.size();
+
+    std::string json = "{";
+    json += "\"mean\": " + std::to_string(mean);
+    json += ", \"p50\": " + std::to_string(BenchStats::percentile(values, 50.0));
+    json += ", \"p90\": " + std::to_string(BenchStats::percentile(values, 90.0));
+    json += ", \"p95\": " + std::to_string(BenchStats::percentile(values, 95.0));
+    json += ", \"p99\": " + std::to_string(BenchStats::percentile(values, 99.0));
+    json += ", \"max\": " + std::to_string(BenchStats::percentile(values, 100.0));
+    json += "}";
+    return json;
+}
+
+void BenchStats::printSummary() const {
+    auto printRow = [](const char* name, const std::vector<double>& values) {
+        std::cout << "  " << name
+                  << "  p50 " << percentile(values, 50.0)
+                  << "  p95 " << percentile(values, 95.0)
+                  << "  p99 " << percentile(values, 99.0)
+                  << "  max " << percentile(values, 100.0) << " ms" << std::endl;
+    };
+
+    std::cout << "Benchmark (" << frameMs.size() << " frames medidos)" << std::endl;
+    printRow("frame  ", frameMs);
+    printRow("physics", physicsMs);
+    printRow("narrow ", narrowphaseMs);
+    printRow("gpu    ", gpuMs);
+    std::cout << "  pares da broadphase  p50 " << percentile(pairCounts, 50.0)
+              << "  max " << percentile(pairCounts, 100.0) << std::endl;
+    std::cout << "  nós testados nas BVHs  p50 " << percentile(nodeTests, 50.0)
+              << "  max " << percentile(nodeTests, 100.0)
+              << "  (cache: " << cacheHitRate * 100.0 << "% das consultas)" << std::endl;
+    std::cout << "  passos da física por frame  p50 " << percentile(subSteps, 50.0)
+              << "  max " << percentile(subSteps, 100.0) << std::endl;
+    std::cout << "  corpos acordados  p50 " << percentile(awakeBodies, 50.0)
+              << "  min " << percentile(awakeBodies, 0.0) << std::endl;
+    std::cout << "  pontos de contato  p50 " << percentile(contactPoints, 50.0)
+              << "  max " << percentile(contactPoints, 100.0)
+              << "  (warm start: " << warmStartRate * 100.0 << "%)" << std::endl;
+    std::cout << "  recuos do CCD  p50 " << percentile(ccdClamps, 50.0)
+              << "  max " << percentile(ccdClamps, 100.0)
+              << "  (poses limitadas: max " << percentile(ccdCapped, 100.0) << ")" << std::endl;
+    std::cout << "  luzes cortadas de clusters cheios  p50 " << percentile(droppedLights, 50.0)
+              << "  max " << percentile(droppedLights, 100.0) << std::endl;
+}
+
+bool BenchStats::writeReport(const BenchOptions& options, const std::string& renderer) const {
+    std::ofstream file(options.reportPath);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever relatório: " << options.reportPath << std::endl;
+        return false;
+    }
+
+    file << "{\n";
+    file << "  \"renderer\": ";
+    writeTraceString(file, renderer);
+    file << ",\n";
+    file << "  \"resolution\": [" << BENCH_WIDTH << ", " << BENCH_HEIGHT << "],\n";
+    file << "  \"frames\": " << options.frames << ",\n";
+    file << "  \"warmup_frames\": " << BENCH_WARMUP << ",\n";
+    file << "  \"timestep\": " << BENCH_TIMESTEP << ",\n";
+    file << "  \"broadphase\": \"" << options.broadphase << "\",\n";
+    file << "  \"narrowphase\": \"" << options.narrowphase << "\",\n";
+    file << "  \"bvh_width\": " << options.bvhWidth << ",\n";
+    file << "  \"contacts\": \"" << options.contacts << "\",\n";
+    file << "  \"traversal_cache\": " << (options.traversalCache ? "true" : "false") << ",\n";
+    file << "  \"traversal_cache_hit_rate\": " << cacheHitRate << ",\n";
+    file << "  \"physics_rate\": " << options.physicsRate << ",\n";
+    file << "  \"max_substeps\": " << options.maxSubSteps << ",\n";
+    file << "  \"physics_thread\": " << (options.physicsThread ? "true" : "false") << ",\n";
+    file << "  \"narrowphase_threads\": " << options.narrowphaseThreads << ",\n";
+    file << "  \"extra_bodies\": " << options.extraBodies << ",\n";
+    file << "  \"sleep\": " << (options.sleep ? "true" : "false") << ",\n";
+    file << "  \"amplitude\": " << options.amplitude << ",\n";
+    file << "  \"solver_iterations\": " << options.solverIterations << ",\n";
+    file << "  \"warm_start\": " << (options.warmStart ? "true" : "false") << ",\n";
+    file << "  \"warm_start_rate\": " << warmStartRate << ",\n";
+    file << "  \"ccd\": " << (options.ccd ? "true" : "false") << ",\n";
+    file << "  \"scene_sdf\": " << (options.sceneField ? "true" : "false") << ",\n";
+    file << "  \"frame_ms\": " << benchSeriesJson(frameMs) << ",\n";
+    file << "  \"physics_ms\": " << benchSeriesJson(physicsMs) << ",\n";
+    file << "  \"narrowphase_ms\": " << benchSeriesJson(narrowphaseMs) << ",\n";
+    file << "  \"gpu_ms\": " << benchSeriesJson(gpuMs) << ",\n";
+    file << "  \"broadphase_pairs\": " << benchSeriesJson(pairCounts) << ",\n";
+    file << "  \"bvh_node_tests\": " << benchSeriesJson(nodeTests) << ",\n";
+    file << "  \"physics_substeps\": " << benchSeriesJson(subSteps) << ",\n";
+    file << "  \"awake_bodies\": " << benchSeriesJson(awakeBodies) << ",\n";
+    file << "  \"contact_points\": " << benchSeriesJson(contactPoints) << ",\n";
+    file << "  \"ccd_clamps\": " << benchSeriesJson(ccdClamps) << ",\n";
+    file << "  \"ccd_capped\": " << benchSeriesJson(ccdCapped) << ",\n";
+    file << "  \"dropped_lights\": " << benchSeriesJson(droppedLights) << "\n";
+    file << "}\n";
+    return true;
+}
+
+#endif
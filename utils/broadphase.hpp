@@ -0,0 +1,721 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <string>
+#include "bvh.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+#define TREE_NULL -1
+#define TREE_STACK_SIZE 256
+#define FAT_AABB_MARGIN 2.0f
+#define GRID_MAX_CELLS_PER_BODY 64
+#define GRID_PARALLEL_THRESHOLD 2048
+#define GRID_MAX_THREADS 16
+
+// par candidato para a narrowphase, sempre com a < b
+struct BroadphasePair {
+    int a;
+    int b;
+
+    bool operator<(const BroadphasePair& o) const { return a < o.a || (a == o.a && b < o.b); }
+};
+
+// Sort-and-sweep: os corpos ficam ordenados pelo mínimo no eixo de maior
+// variância. Entre frames a ordem quase não muda, então a ordenação por
+// inserção custa ~O(n) e a varredura só compara vizinhos que se sobrepõem no eixo.
+struct SweepAndPrune {
+    std::vector<BroadphasePair> pairs;
+    int axis = 0;
+    int sortSwaps = 0;  // trocas na última atualização (coerência temporal)
+
+    void update(const std::vector<AABB>& bounds);
+
+private:
+    std::vector<int> order;
+
+    void chooseAxis(const std::vector<AABB>& bounds);
+};
+
+void SweepAndPrune::chooseAxis(const std::vector<AABB>& bounds) {
+    glm::vec3 sum(0.0f), sumSq(0.0f);
+    for (const AABB& b : bounds) {
+        glm::vec3 center = (b.min_corner + b.max_corner) * 0.5f;
+        sum += center;
+        sumSq += center * center;
+    }
+
+    glm::vec3 variance = sumSq / (float)bounds.size() - (sum * sum) / (float)(bounds.size() * bounds.size());
+    axis = 0;
+    if (variance.y > variance[axis]) axis = 1;
+    if (variance.z > variance[axis]) axis = 2;
+}
+
+void SweepAndPrune::update(const std::vector<AABB>& bounds) {
+    PROFILE_FUNCTION();
+
+    pairs.clear();
+    sortSwaps = 0;
+
+    // corpos adicionados/removidos: recomeça a ordem
+    if (order.size() != bounds.size()) {
+        order.resize(bounds.size());
+        std::iota(order.begin(), order.end(), 0);
+    }
+    if (bounds.empty()) return;
+
+    chooseAxis(bounds);
+
+    for (size_t i = 1; i < order.size(); i++) {
+        int body = order[i];
+        float key = bounds[body].min_corner[axis];
+
+        size_t j = i;
+        while (j > 0 && bounds[order[j - 1]].min_corner[axis] > key) {
+            order[j] = order[j - 1];
+            j--;
+            sortSwaps++;
+        }
+        order[j] = body;
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const AABB& a = bounds[order[i]];
+
+        for (size_t j = i + 1; j < order.size(); j++) {
+            const AABB& b = bounds[order[j]];
+            if (b.min_corner[axis] > a.max_corner[axis])
+                break;
+
+            if (checkAABBCollision(a, b))
+                pairs.push_back({std::min(order[i], order[j]), std::max(order[i], order[j])});
+        }
+    }
+
+    // mesma ordem do laço i < j original: a resposta às colisões não depende da varredura
+    std::sort(pairs.begin(), pairs.end());
+}
+
+struct DynamicTreeNode {
+    AABB box;
+    int parent = TREE_NULL;  // nos nós livres: próximo da free list
+    int left = TREE_NULL;
+    int right = TREE_NULL;
+    int height = -1;         // -1 = livre, 0 = folha
+    int body = -1;
+
+    bool isLeaf() const { return left == TREE_NULL; }
+};
+
+// Árvore de AABBs dinâmica (estilo Box2D): folhas guardam caixas "gordas",
+// aumentadas por uma margem, e só são reinseridas quando o corpo sai dela.
+// Móveis parados ou pouco agitados praticamente não mexem na árvore.
+// Os nós vivem em um pool contíguo com free list e a árvore é mantida
+// balanceada por rotações (AVL) na subida após cada inserção/remoção.
+struct DynamicAABBTree {
+    std::vector<BroadphasePair> pairs;
+    float margin = FAT_AABB_MARGIN;
+    int reinsertions = 0;  // folhas reinseridas na última atualização
+
+    int createProxy(const AABB& box, int body);
+    void destroyProxy(int proxy);
+    bool moveProxy(int proxy, const AABB& box);
+
+    // sincroniza um proxy por corpo (índice = corpo) e gera os pares
+    void update(const std::vector<AABB>& bounds);
+
+    // só a sincronização, sem pares; devolve as folhas reinseridas
+    int sync(const std::vector<AABB>& bounds);
+    void moveBody(int body, const AABB& box) { moveProxy(proxies[body], box); }
+
+    // callback(body) -> bool: false interrompe a busca
+    template<typename Callback>
+    void queryBox(const AABB& box, Callback&& callback) const;
+
+    // callback(body, tEntry) -> float: nova distância máxima (0 interrompe)
+    template<typename Callback>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const;
+
+    int height() const { return root == TREE_NULL ? 0 : nodes[root].height; }
+    int nodeCount() const { return used; }
+    const AABB& fatBox(int proxy) const { return nodes[proxy].box; }
+
+private:
+    std::vector<DynamicTreeNode> nodes;
+    std::vector<int> proxies;  // proxy de cada corpo
+    int root = TREE_NULL;
+    int freeList = TREE_NULL;
+    int used = 0;
+
+    int allocateNode();
+    void freeNode(int index);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int index);
+    int balance(int index);
+};
+
+int DynamicAABBTree::allocateNode() {
+    int index;
+    if (freeList == TREE_NULL) {
+        index = (int)nodes.size();
+        nodes.emplace_back();
+    } else {
+        index = freeList;
+        freeList = nodes[index].parent;
+    }
+
+    nodes[index] = DynamicTreeNode();
+    nodes[index].height = 0;
+    used++;
+    return index;
+}
+
+void DynamicAABBTree::freeNode(int index) {
+    nodes[index].parent = freeList;
+    nodes[index].height = -1;
+    freeList = index;
+    used--;
+}
+
+int DynamicAABBTree::createProxy(const AABB& box, int body) {
+    int proxy = allocateNode();
+    nodes[proxy].box = AABB{box.min_corner - glm::vec3(margin), box.max_corner + glm::vec3(margin)};
+    nodes[proxy].body = body;
+    insertLeaf(proxy);
+    return proxy;
+}
+
+void DynamicAABBTree::destroyProxy(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+}
+
+bool DynamicAABBTree::moveProxy(int proxy, const AABB& box) {
+    if (aabbContains(nodes[proxy].box, box))
+        return false;
+
+    removeLeaf(proxy);
+    nodes[proxy].box = AABB{box.min_corner - glm::vec3(margin), box.max_corner + glm::vec3(margin)};
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+    if (root == TREE_NULL) {
+        root = leaf;
+        nodes[root].parent = TREE_NULL;
+        return;
+    }
+
+    // desce escolhendo o irmão de menor custo de área (heurística de Box2D)
+    AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        const DynamicTreeNode& node = nodes[index];
+        float area = aabbSurfaceArea(node.box);
+        float combinedArea = aabbSurfaceArea(aabbUnion(node.box, leafBox));
+
+        float cost = 2.0f * combinedArea;                      // novo pai aqui
+        float inheritance = 2.0f * (combinedArea - area);     // crescimento dos ancestrais
+
+        auto descendCost = [&](int child) {
+            float grown = aabbSurfaceArea(aabbUnion(leafBox, nodes[child].box));
+            if (nodes[child].isLeaf())
+                return grown + inheritance;
+            return grown - aabbSurfaceArea(nodes[child].box) + inheritance;
+        };
+
+        float costLeft = descendCost(node.left);
+        float costRight = descendCost(node.right);
+        if (cost < costLeft && cost < costRight)
+            break;
+
+        index = costLeft < costRight ? node.left : node.right;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();  // pode realocar o pool: sem referências vivas aqui
+
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = aabbUnion(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == TREE_NULL)
+        root = newParent;
+    else if (nodes[oldParent].left == sibling)
+        nodes[oldParent].left = newParent;
+    else
+        nodes[oldParent].right = newParent;
+
+    refit(newParent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = TREE_NULL;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent == TREE_NULL) {
+        root = sibling;
+        nodes[sibling].parent = TREE_NULL;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].left == parent)
+        nodes[grandParent].left = sibling;
+    else
+        nodes[grandParent].right = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    refit(grandParent);
+}
+
+// Sobe até a raiz balanceando e recalculando caixas/alturas
+void DynamicAABBTree::refit(int index) {
+    while (index != TREE_NULL) {
+        index = balance(index);
+
+        DynamicTreeNode& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+        node.box = aabbUnion(nodes[node.left].box, nodes[node.right].box);
+
+        index = node.parent;
+    }
+}
+
+// Rotação AVL: se um filho está 2+ níveis mais alto, ele sobe para o lugar de A
+int DynamicAABBTree::balance(int iA) {
+    DynamicTreeNode& A = nodes[iA];
+    if (A.isLeaf() || A.height < 2)
+        return iA;
+
+    int iB = A.left;
+    int iC = A.right;
+    DynamicTreeNode& B = nodes[iB];
+    DynamicTreeNode& C = nodes[iC];
+    int diff = C.height - B.height;
+
+    if (diff > 1) {
+        int iF = C.left;
+        int iG = C.right;
+        DynamicTreeNode& F = nodes[iF];
+        DynamicTreeNode& G = nodes[iG];
+
+        C.left = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        if (C.parent == TREE_NULL) root = iC;
+        else if (nodes[C.parent].left == iA) nodes[C.parent].left = iC;
+        else nodes[C.parent].right = iC;
+
+        // o neto mais alto fica com C, o outro desce para A
+        if (F.height > G.height) {
+            C.right = iF;
+            A.right = iG;
+            G.parent = iA;
+            A.box = aabbUnion(B.box, G.box);
+            C.box = aabbUnion(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.right = iG;
+            A.right = iF;
+            F.parent = iA;
+            A.box = aabbUnion(B.box, F.box);
+            C.box = aabbUnion(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    if (diff < -1) {
+        int iD = B.left;
+        int iE = B.right;
+        DynamicTreeNode& D = nodes[iD];
+        DynamicTreeNode& E = nodes[iE];
+
+        B.left = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        if (B.parent == TREE_NULL) root = iB;
+        else if (nodes[B.parent].left == iA) nodes[B.parent].left = iB;
+        else nodes[B.parent].right = iB;
+
+        if (D.height > E.height) {
+            B.right = iD;
+            A.left = iE;
+            E.parent = iA;
+            A.box = aabbUnion(C.box, E.box);
+            B.box = aabbUnion(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.right = iE;
+            A.left = iD;
+            D.parent = iA;
+            A.box = aabbUnion(C.box, D.box);
+            B.box = aabbUnion(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+template<typename Callback>
+void DynamicAABBTree::queryBox(const AABB& box, Callback&& callback) const {
+    if (root == TREE_NULL) return;
+
+    // altura AVL ~1.44 log2(n): a pilha fixa sobra para qualquer cena realista
+    int stack[TREE_STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+
+    while (top > 0) {
+        const DynamicTreeNode& node = nodes[stack[--top]];
+        if (!checkAABBCollision(node.box, box))
+            continue;
+
+        if (node.isLeaf()) {
+            if (!callback(node.body))
+                return;
+        } else {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicAABBTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const {
+    if (root == TREE_NULL) return;
+
+    glm::vec3 invDir = 1.0f / direction;
+    int stack[TREE_STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+
+    while (top > 0) {
+        const DynamicTreeNode& node = nodes[stack[--top]];
+        float tEntry;
+        if (!rayIntersectsAABB(origin, invDir, maxDistance, node.box, tEntry))
+            continue;
+
+        if (node.isLeaf()) {
+            // o chamador pode encurtar o raio com a distância exata do acerto
+            float clipped = callback(node.body, tEntry);
+            if (clipped <= 0.0f)
+                return;
+            maxDistance = std::min(maxDistance, clipped);
+        } else {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+int DynamicAABBTree::sync(const std::vector<AABB>& bounds) {
+    while (proxies.size() > bounds.size()) {
+        destroyProxy(proxies.back());
+        proxies.pop_back();
+    }
+
+    int moved = 0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (i == proxies.size())
+            proxies.push_back(createProxy(bounds[i], (int)i));
+        else if (moveProxy(proxies[i], bounds[i]))
+            moved++;
+    }
+    return moved;
+}
+
+void DynamicAABBTree::update(const std::vector<AABB>& bounds) {
+    PROFILE_FUNCTION();
+
+    pairs.clear();
+    reinsertions = sync(bounds);
+
+    // folhas são gordas: confirma com as caixas justas e mantém só body > i
+    for (int i = 0; i < (int)bounds.size(); i++) {
+        queryBox(bounds[i], [&](int body) {
+            if (body > i && checkAABBCollision(bounds[i], bounds[body]))
+                pairs.push_back({i, body});
+            return true;
+        });
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
+
+// Grade uniforme com hash espacial para muitos corpos pequenos de tamanho
+// parecido (livros, destroços). É reconstruída a cada passo com uma
+// ordenação por contagem em arrays planos: cada thread conta as entradas
+// (corpo, célula) da sua faixa de corpos, um prefixo dá os deslocamentos e
+// cada thread espalha as suas sem disputa. Corpos grandes demais para a grade
+// vão para uma lista à parte testada contra todos.
+struct SpatialHashGrid {
+    std::vector<BroadphasePair> pairs;
+    float cellSize = 0.0f;  // 0 = automático (2x a maior dimensão média dos corpos)
+    int entries = 0;        // entradas (corpo, célula) no último passo
+    int oversized = 0;
+
+    void update(const std::vector<AABB>& bounds);
+
+private:
+    std::vector<glm::ivec3> cellMin, cellMax;
+    std::vector<GLuint> bucketStart;  // bucketStart[h]..bucketStart[h+1] em cellBodies
+    std::vector<int> cellBodies;
+    std::vector<int> largeBodies;
+    std::vector<GLuint> threadCounts;  // [faixa][bucket]
+    GLuint bucketMask = 0;
+    float usedCellSize = 1.0f;
+    std::unique_ptr<WorkStealingPool> pool;  // criado no primeiro passo paralelo
+
+    glm::ivec3 cellOf(const glm::vec3& p) const;
+    GLuint bucketOf(int x, int y, int z) const;
+
+    template<typename Body>
+    void parallelFor(int count, int threads, Body&& body);
+};
+
+glm::ivec3 SpatialHashGrid::cellOf(const glm::vec3& p) const {
+    return glm::ivec3(glm::floor(p / usedCellSize));
+}
+
+GLuint SpatialHashGrid::bucketOf(int x, int y, int z) const {
+    return ((GLuint)x * 73856093u ^ (GLuint)y * 19349663u ^ (GLuint)z * 83492791u) & bucketMask;
+}
+
+// body(faixa, begin, end) sobre threads faixas contíguas de [0, count), no
+// pool do grid; cada faixa roda uma vez só, então indexa os buffers por faixa
+template<typename Body>
+void SpatialHashGrid::parallelFor(int count, int threads, Body&& body) {
+    if (threads == 1) {
+        body(0, 0, count);
+        return;
+    }
+
+    if (!pool || pool->size() != threads)
+        pool = std::make_unique<WorkStealingPool>(threads);
+    int chunk = (count + threads - 1) / threads;
+    pool->parallelFor(threads, [&](int t, int) {
+        int begin = t * chunk;
+        body(t, begin, std::min(begin + chunk, count));
+    });
+}
+
+void SpatialHashGrid::update(const std::vector<AABB>& bounds) {
+    PROFILE_FUNCTION();
+
+    pairs.clear();
+    largeBodies.clear();
+    entries = 0;
+    oversized = 0;
+
+    int count = (int)bounds.size();
+    if (count == 0) return;
+
+    int threads = 1;
+    if (count >= GRID_PARALLEL_THRESHOLD)
+        threads = (int)std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)GRID_MAX_THREADS));
+
+    usedCellSize = cellSize;
+    if (usedCellSize <= 0.0f) {
+        float extent = 0.0f;
+        for (const AABB& b : bounds) {
+            glm::vec3 d = b.max_corner - b.min_corner;
+            extent += std::max(d.x, std::max(d.y, d.z));
+        }
+        usedCellSize = std::max(2.0f * extent / count, 1e-3f);
+    }
+
+    // faixa de células de cada corpo
+    cellMin.resize(count);
+    cellMax.resize(count);
+    std::vector<int> cellsPerBody(count);
+    for (int i = 0; i < count; i++) {
+        cellMin[i] = cellOf(bounds[i].min_corner);
+        cellMax[i] = cellOf(bounds[i].max_corner);
+
+        glm::ivec3 span = cellMax[i] - cellMin[i] + glm::ivec3(1);
+        long cells = (long)span.x * span.y * span.z;
+        if (cells > GRID_MAX_CELLS_PER_BODY) {
+            largeBodies.push_back(i);
+            cellsPerBody[i] = 0;
+        } else {
+            cellsPerBody[i] = (int)cells;
+            entries += (int)cells;
+        }
+    }
+    oversized = (int)largeBodies.size();
+
+    // tabela com ~2 buckets por entrada (potência de 2)
+    GLuint buckets = 1;
+    while (buckets < (GLuint)std::max(entries * 2, 1)) buckets <<= 1;
+    bucketMask = buckets - 1;
+
+    auto forEachCell = [&](int i, auto&& visit) {
+        for (int z = cellMin[i].z; z <= cellMax[i].z; z++)
+            for (int y = cellMin[i].y; y <= cellMax[i].y; y++)
+                for (int x = cellMin[i].x; x <= cellMax[i].x; x++)
+                    visit(x, y, z);
+    };
+
+    // 1. contagem por thread
+    threadCounts.assign((size_t)threads * buckets, 0);
+    parallelFor(count, threads, [&](int t, int begin, int end) {
+        GLuint* counts = &threadCounts[(size_t)t * buckets];
+        for (int i = begin; i < end; i++) {
+            if (cellsPerBody[i] == 0) continue;
+            forEachCell(i, [&](int x, int y, int z) { counts[bucketOf(x, y, z)]++; });
+        }
+    });
+
+    // 2. prefixo: threadCounts vira o deslocamento de escrita de cada thread
+    bucketStart.resize(buckets + 1);
+    GLuint offset = 0;
+    for (GLuint h = 0; h < buckets; h++) {
+        bucketStart[h] = offset;
+        for (int t = 0; t < threads; t++) {
+            GLuint n = threadCounts[(size_t)t * buckets + h];
+            threadCounts[(size_t)t * buckets + h] = offset;
+            offset += n;
+        }
+    }
+    bucketStart[buckets] = offset;
+
+    // 3. espalhamento: cada bucket fica ordenado por índice de corpo
+    cellBodies.resize(entries);
+    parallelFor(count, threads, [&](int t, int begin, int end) {
+        GLuint* cursor = &threadCounts[(size_t)t * buckets];
+        for (int i = begin; i < end; i++) {
+            if (cellsPerBody[i] == 0) continue;
+            forEachCell(i, [&](int x, int y, int z) { cellBodies[cursor[bucketOf(x, y, z)]++] = i; });
+        }
+    });
+
+    // 4. pares: um par só é emitido na célula que contém o canto mínimo da
+    // interseção das caixas, então sai uma vez só mesmo ocupando várias
+    // células. Duas células de j no mesmo bucket põem j duas vezes seguidas
+    // nele (o bucket é ordenado por corpo); a repetição é pulada.
+    std::vector<std::vector<BroadphasePair>> threadPairs(threads);
+    parallelFor(count, threads, [&](int t, int begin, int end) {
+        std::vector<BroadphasePair>& out = threadPairs[t];
+        for (int i = begin; i < end; i++) {
+            if (cellsPerBody[i] == 0) continue;
+
+            forEachCell(i, [&](int x, int y, int z) {
+                GLuint h = bucketOf(x, y, z);
+                for (GLuint k = bucketStart[h]; k < bucketStart[h + 1]; k++) {
+                    int j = cellBodies[k];
+                    if (k > bucketStart[h] && cellBodies[k - 1] == j)
+                        continue;
+                    if (j <= i || !checkAABBCollision(bounds[i], bounds[j]))
+                        continue;
+
+                    glm::ivec3 owner = cellOf(glm::max(bounds[i].min_corner, bounds[j].min_corner));
+                    if (owner == glm::ivec3(x, y, z))
+                        out.push_back({i, j});
+                }
+            });
+        }
+    });
+
+    for (const std::vector<BroadphasePair>& p : threadPairs)
+        pairs.insert(pairs.end(), p.begin(), p.end());
+
+    for (int large : largeBodies) {
+        for (int j = 0; j < count; j++) {
+            if (j == large || !checkAABBCollision(bounds[large], bounds[j]))
+                continue;
+            // dois corpos grandes: só o de menor índice emite
+            if (cellsPerBody[j] == 0 && j < large)
+                continue;
+            pairs.push_back({std::min(large, j), std::max(large, j)});
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
+
+enum BroadphaseType {
+    BROADPHASE_SAP,
+    BROADPHASE_TREE,
+    BROADPHASE_GRID
+};
+
+// Seleção da broadphase em tempo de execução (--broadphase), para comparar na mesma cena
+struct Broadphase {
+    BroadphaseType type = BROADPHASE_SAP;
+    SweepAndPrune sap;
+    DynamicAABBTree tree;
+    SpatialHashGrid grid;
+
+    const std::vector<BroadphasePair>& update(const std::vector<AABB>& bounds);
+    const std::vector<BroadphasePair>& pairs() const;
+    const char* name() const;
+
+    static bool parseType(const std::string& name, BroadphaseType& type);
+};
+
+const std::vector<BroadphasePair>& Broadphase::update(const std::vector<AABB>& bounds) {
+    switch (type) {
+        case BROADPHASE_TREE: tree.update(bounds); break;
+        case BROADPHASE_GRID: grid.update(bounds); break;
+        default: sap.update(bounds); break;
+    }
+    return pairs();
+}
+
+const std::vector<BroadphasePair>& Broadphase::pairs() const {
+    switch (type) {
+        case BROADPHASE_TREE: return tree.pairs;
+        case BROADPHASE_GRID: return grid.pairs;
+        default: return sap.pairs;
+    }
+}
+
+const char* Broadphase::name() const {
+    switch (type) {
+        case BROADPHASE_TREE: return "tree";
+        case BROADPHASE_GRID: return "grid";
+        default: return "sap";
+    }
+}
+
+bool Broadphase::parseType(const std::string& name, BroadphaseType& type) {
+    if (name == "sap") type = BROADPHASE_SAP;
+    else if (name == "tree") type = BROADPHASE_TREE;
+    else if (name == "grid") type = BROADPHASE_GRID;
+    else return false;
+    return true;
+}
+
+#endif
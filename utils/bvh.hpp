@@ -0,0 +1,446 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <thread>
+
+#define BVH_BINS 12
+#define BVH_LEAF_TRIANGLES 2       // abaixo disso não tenta dividir
+#define BVH_MAX_LEAF_TRIANGLES 16  // acima disso divide mesmo que o SAH não compense
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_TRIANGLE_COST 1.0f
+#define BVH_MAX_DEPTH 48
+#define BVH_PAIR_STACK_SIZE 512      // 3 * (2 * BVH_MAX_DEPTH) + 1 pares no pior caso
+#define BVH_PARALLEL_THRESHOLD 4096  // triângulos mínimos para construir uma subárvore em outra thread
+#define OBB_EPSILON 1e-6f            // evita eixos degenerados (arestas paralelas) no SAT
+
+struct AABB {
+    glm::vec3 min_corner;
+    glm::vec3 max_corner;
+};
+
+bool checkAABBCollision(const AABB &a, const AABB &b)
+{
+    return (a.min_corner.x <= b.max_corner.x && a.max_corner.x >= b.min_corner.x) &&
+           (a.min_corner.y <= b.max_corner.y && a.max_corner.y >= b.min_corner.y) &&
+           (a.min_corner.z <= b.max_corner.z && a.max_corner.z >= b.min_corner.z);
+}
+
+// AABB que envolve a caixa transformada (os 8 cantos)
+AABB transformAABB(const AABB& box, const glm::mat4& transform) {
+    glm::vec3 corners[8] = {
+        box.min_corner,
+        glm::vec3(box.min_corner.x, box.min_corner.y, box.max_corner.z),
+        glm::vec3(box.min_corner.x, box.max_corner.y, box.min_corner.z),
+        glm::vec3(box.min_corner.x, box.max_corner.y, box.max_corner.z),
+        glm::vec3(box.max_corner.x, box.min_corner.y, box.min_corner.z),
+        glm::vec3(box.max_corner.x, box.min_corner.y, box.max_corner.z),
+        glm::vec3(box.max_corner.x, box.max_corner.y, box.min_corner.z),
+        box.max_corner
+    };
+
+    glm::vec3 minT = glm::vec3(transform * glm::vec4(corners[0], 1.0f));
+    glm::vec3 maxT = minT;
+
+    for (int i = 1; i < 8; ++i) {
+        glm::vec3 t = glm::vec3(transform * glm::vec4(corners[i], 1.0f));
+        minT = glm::min(minT, t);
+        maxT = glm::max(maxT, t);
+    }
+
+    return AABB{minT, maxT};
+}
+
+AABB aabbUnion(const AABB& a, const AABB& b) {
+    return AABB{glm::min(a.min_corner, b.min_corner), glm::max(a.max_corner, b.max_corner)};
+}
+
+float aabbSurfaceArea(const AABB& box) {
+    glm::vec3 d = box.max_corner - box.min_corner;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool aabbContains(const AABB& outer, const AABB& inner) {
+    return outer.min_corner.x <= inner.min_corner.x && outer.max_corner.x >= inner.max_corner.x &&
+           outer.min_corner.y <= inner.min_corner.y && outer.max_corner.y >= inner.max_corner.y &&
+           outer.min_corner.z <= inner.min_corner.z && outer.max_corner.z >= inner.max_corner.z;
+}
+
+// caixa "vazia": qualquer união com ela resulta na outra caixa
+AABB emptyAABB() {
+    return AABB{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+}
+
+// Teste de slabs; tEntry é a distância de entrada ao longo do raio (0 se a origem está dentro)
+bool rayIntersectsAABB(const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, const AABB& box, float& tEntry) {
+    glm::vec3 t0 = (box.min_corner - origin) * invDir;
+    glm::vec3 t1 = (box.max_corner - origin) * invDir;
+    glm::vec3 tMin = glm::min(t0, t1);
+    glm::vec3 tMax = glm::max(t0, t1);
+
+    float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+
+    tEntry = enter;
+    return enter <= exit;
+}
+
+// Möller–Trumbore; t é a distância ao longo de direction (não precisa ser unitária)
+bool rayIntersectsTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t) {
+    glm::vec3 edge1 = b - a;
+    glm::vec3 edge2 = c - a;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < 1e-12f) return false;
+
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(edge2, q) * invDet;
+    return t >= 0.0f;
+}
+
+// Nó compacto de 32 bytes em ordem de profundidade: o filho esquerdo é
+// sempre o próximo nó do array, então basta guardar o índice do direito.
+// Dois nós por linha de cache e nenhuma alocação por nó.
+struct alignas(32) BVHNode {
+    glm::vec3 min_corner;
+    GLuint offset;          // interno: índice do filho direito; folha: primeiro triângulo
+    glm::vec3 max_corner;
+    GLuint triangleCount;   // 0 = nó interno
+
+    bool isLeaf() const { return triangleCount > 0; }
+    AABB box() const { return AABB{min_corner, max_corner}; }
+    AABB getTransformed(const glm::mat4& transform) const { return transformAABB(box(), transform); }
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode deve ter 32 bytes");
+
+// Qualidade da árvore: custo SAH esperado de um raio/consulta relativo à raiz
+struct BVHStats {
+    int triangles = 0;
+    int nodes = 0;
+    int leaves = 0;
+    int maxDepth = 0;
+    float sahCost = 0.0f;
+};
+
+// Teste entre nós de duas BVHs feito no espaço local de A. B entra por uma
+// única transformação relativa inverse(aTransform) * bTransform, então cada
+// nó de B vira um paralelepípedo (OBB, com escala) contra uma caixa alinhada.
+// Os termos absolutos são calculados uma vez por par de modelos; cada par de
+// nós custa um produto matriz-vetor e no máximo 15 eixos separadores, sem
+// transformar cantos e sem o inchaço de envolver caixas giradas em AABBs.
+struct RelativeTransform {
+    glm::mat3 rotation;      // coluna j = eixo j de B no espaço de A (inclui escala)
+    glm::vec3 translation;
+    glm::mat3 absRotation;   // |rotation|
+    glm::mat3 inverse;       // linha i = normal da face i de B no espaço de A
+    glm::mat3 absInverse;
+    glm::mat3 absCross;      // coluna l = |eixo l+1 × eixo l+2| (arestas × arestas)
+
+    RelativeTransform(const glm::mat4& aTransform, const glm::mat4& bTransform);
+
+    bool overlaps(const BVHNode& a, const BVHNode& b) const;
+};
+
+RelativeTransform::RelativeTransform(const glm::mat4& aTransform, const glm::mat4& bTransform) {
+    glm::mat4 relative = glm::inverse(aTransform) * bTransform;
+    rotation = glm::mat3(relative);
+    translation = glm::vec3(relative[3]);
+    inverse = glm::inverse(rotation);
+
+    for (int j = 0; j < 3; j++) {
+        glm::vec3 edgeCross = glm::cross(rotation[(j + 1) % 3], rotation[(j + 2) % 3]);
+        for (int k = 0; k < 3; k++) {
+            absRotation[j][k] = std::abs(rotation[j][k]) + OBB_EPSILON;
+            absInverse[j][k] = std::abs(inverse[j][k]) + OBB_EPSILON;
+            absCross[j][k] = std::abs(edgeCross[k]) + OBB_EPSILON;
+        }
+    }
+}
+
+bool RelativeTransform::overlaps(const BVHNode& a, const BVHNode& b) const {
+    glm::vec3 aCenter = (a.min_corner + a.max_corner) * 0.5f;
+    glm::vec3 aHalf = (a.max_corner - a.min_corner) * 0.5f;
+    glm::vec3 bHalf = (b.max_corner - b.min_corner) * 0.5f;
+
+    // centro de B menos centro de A, no espaço de A
+    glm::vec3 t = rotation * ((b.min_corner + b.max_corner) * 0.5f) + translation - aCenter;
+
+    // faces de A: o mesmo teste da AABB de B no espaço de A
+    glm::vec3 bRadius = absRotation * bHalf;
+    for (int k = 0; k < 3; k++)
+        if (std::abs(t[k]) > aHalf[k] + bRadius[k]) return false;
+
+    // faces de B
+    glm::vec3 tB = inverse * t;
+    glm::vec3 aRadius = absInverse * aHalf;
+    for (int i = 0; i < 3; i++)
+        if (std::abs(tB[i]) > aRadius[i] + bHalf[i]) return false;
+
+    // arestas de A (eixo k) × arestas de B (eixo j)
+    for (int j = 0; j < 3; j++) {
+        int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        glm::vec3 distance = glm::cross(rotation[j], t);
+
+        for (int k = 0; k < 3; k++) {
+            int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+            float ra = aHalf[k1] * absRotation[j][k2] + aHalf[k2] * absRotation[j][k1];
+            float rb = bHalf[j1] * absCross[j2][k] + bHalf[j2] * absCross[j1][k];
+            if (std::abs(distance[k]) > ra + rb) return false;
+        }
+    }
+
+    return true;
+}
+
+// Nó provisório da construção. A subárvore de um intervalo [begin, end) de
+// triângulos só usa os slots [2*begin, 2*end - 1): a folha fica em 2*begin e
+// um nó interno dividido em mid fica em 2*mid - 1, entre as duas metades.
+// Assim subárvores disjuntas são construídas em threads diferentes sem
+// sincronização e sem vetores temporários por nível.
+struct BVHBuildNode {
+    AABB box;
+    GLuint left, right;   // slots dos filhos (nó interno)
+    GLuint first, count;  // intervalo em order (folha: count > 0)
+};
+
+// BVH sobre triângulos com SAH em bins. Os triângulos são particionados em
+// uma permutação, sem copiar vértices; ao final o index buffer da malha é
+// reordenado para que cada folha seja um intervalo contíguo de triângulos.
+struct TriangleBVHBuilder {
+    std::vector<AABB> triangleBounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<GLuint> order;
+    std::vector<BVHBuildNode> slots;  // 2n - 1
+    std::atomic<int> nodeCount{0};
+    int parallelDepth = 0;            // até essa profundidade subárvores grandes ganham uma thread
+
+    GLuint build(GLuint begin, GLuint end, int depth);
+    GLuint makeLeaf(const AABB& box, GLuint begin, GLuint end);
+    void flatten(GLuint slot, int depth, std::vector<BVHNode>& nodes, BVHStats& stats) const;
+};
+
+GLuint TriangleBVHBuilder::makeLeaf(const AABB& box, GLuint begin, GLuint end) {
+    GLuint slot = 2 * begin;
+    slots[slot] = BVHBuildNode{box, 0, 0, begin, end - begin};
+    return slot;
+}
+
+// Retorna o slot do nó
+GLuint TriangleBVHBuilder::build(GLuint begin, GLuint end, int depth) {
+    nodeCount.fetch_add(1, std::memory_order_relaxed);
+
+    AABB box = emptyAABB();
+    AABB centroidBox = emptyAABB();
+    for (GLuint i = begin; i < end; i++) {
+        box = aabbUnion(box, triangleBounds[order[i]]);
+        centroidBox = aabbUnion(centroidBox, AABB{centroids[order[i]], centroids[order[i]]});
+    }
+
+    GLuint count = end - begin;
+    if (count <= BVH_LEAF_TRIANGLES || depth >= BVH_MAX_DEPTH)
+        return makeLeaf(box, begin, end);
+
+    // melhor plano entre os limites de bins nos três eixos
+    glm::vec3 extent = centroidBox.max_corner - centroidBox.min_corner;
+    float parentArea = aabbSurfaceArea(box);
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    int bestSplit = 0;
+
+    auto binOf = [&](GLuint triangle, int axis) {
+        float t = (centroids[triangle][axis] - centroidBox.min_corner[axis]) / extent[axis];
+        return std::min((int)(t * BVH_BINS), BVH_BINS - 1);
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) continue;
+
+        AABB binBox[BVH_BINS];
+        int binCount[BVH_BINS] = {0};
+        for (int b = 0; b < BVH_BINS; b++) binBox[b] = emptyAABB();
+
+        for (GLuint i = begin; i < end; i++) {
+            int b = binOf(order[i], axis);
+            binBox[b] = aabbUnion(binBox[b], triangleBounds[order[i]]);
+            binCount[b]++;
+        }
+
+        // varredura da direita guarda área*quantidade de cada sufixo
+        float rightCost[BVH_BINS];
+        AABB acc = emptyAABB();
+        int accCount = 0;
+        for (int b = BVH_BINS - 1; b > 0; b--) {
+            acc = aabbUnion(acc, binBox[b]);
+            accCount += binCount[b];
+            rightCost[b] = accCount ? aabbSurfaceArea(acc) * accCount : 0.0f;
+        }
+
+        acc = emptyAABB();
+        accCount = 0;
+        for (int split = 1; split < BVH_BINS; split++) {
+            acc = aabbUnion(acc, binBox[split - 1]);
+            accCount += binCount[split - 1];
+            if (accCount == 0 || accCount == (int)count) continue;
+
+            float cost = BVH_TRAVERSAL_COST + BVH_TRIANGLE_COST * (aabbSurfaceArea(acc) * accCount + rightCost[split]) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    float leafCost = BVH_TRIANGLE_COST * count;
+    if (bestAxis < 0 || bestCost >= leafCost) {
+        if (count <= BVH_MAX_LEAF_TRIANGLES)
+            return makeLeaf(box, begin, end);
+    }
+
+    GLuint mid;
+    if (bestAxis >= 0) {
+        auto it = std::partition(order.begin() + begin, order.begin() + end,
+            [&](GLuint triangle) { return binOf(triangle, bestAxis) < bestSplit; });
+        mid = (GLuint)(it - order.begin());
+    } else {
+        // centroides coincidentes: divide ao meio só para limitar a folha
+        mid = begin + count / 2;
+    }
+
+    GLuint left, right;
+    if (count >= BVH_PARALLEL_THRESHOLD && depth < parallelDepth) {
+        // os dois lados tocam intervalos disjuntos de order e de slots
+        std::thread worker([&] { left = build(begin, mid, depth + 1); });
+        right = build(mid, end, depth + 1);
+        worker.join();
+    } else {
+        left = build(begin, mid, depth + 1);
+        right = build(mid, end, depth + 1);
+    }
+
+    GLuint slot = 2 * mid - 1;
+    slots[slot] = BVHBuildNode{box, left, right, 0, 0};
+    return slot;
+}
+
+// Emite os nós em pré-ordem (esquerdo = index + 1) e coleta as estatísticas
+void TriangleBVHBuilder::flatten(GLuint slot, int depth, std::vector<BVHNode>& nodes, BVHStats& stats) const {
+    const BVHBuildNode& build = slots[slot];
+    GLuint index = (GLuint)nodes.size();
+    nodes.push_back(BVHNode{build.box.min_corner, build.first, build.box.max_corner, build.count});
+    stats.nodes++;
+
+    if (build.count > 0) {
+        stats.leaves++;
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        return;
+    }
+
+    flatten(build.left, depth + 1, nodes, stats);
+    nodes[index].offset = (GLuint)nodes.size();
+    flatten(build.right, depth + 1, nodes, stats);
+}
+
+float bvhSahCost(const std::vector<BVHNode>& nodes) {
+    float rootArea = aabbSurfaceArea(nodes[0].box());
+    if (rootArea <= 0.0f) return 0.0f;
+
+    float cost = 0.0f;
+    for (const BVHNode& node : nodes) {
+        float area = aabbSurfaceArea(node.box()) / rootArea;
+        cost += node.isLeaf() ? area * BVH_TRIANGLE_COST * node.triangleCount : area * BVH_TRAVERSAL_COST;
+    }
+    return cost;
+}
+
+// Raio contra a BVH binária; leaf(first, count) devolve a nova distância máxima (<= 0 encerra)
+template<typename Callback>
+void bvhRaycast(const std::vector<BVHNode>& nodes, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& leaf) {
+    if (nodes.empty()) return;
+
+    glm::vec3 invDir = 1.0f / direction;
+    GLuint stack[BVH_MAX_DEPTH + 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        GLuint index = stack[--top];
+        const BVHNode& node = nodes[index];
+        float tEntry;
+        if (!rayIntersectsAABB(origin, invDir, maxDistance, node.box(), tEntry))
+            continue;
+
+        if (node.isLeaf()) {
+            float clipped = leaf(node.offset, node.triangleCount);
+            if (clipped <= 0.0f)
+                return;
+            maxDistance = std::min(maxDistance, clipped);
+        } else {
+            stack[top++] = node.offset;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+// Constrói a BVH e reordena indices (triângulos) para casar com as folhas.
+// Pode ser chamada de várias threads ao mesmo tempo (uma malha por chamada).
+template<typename VertexType>
+std::vector<BVHNode> buildAABBTree(const std::vector<VertexType>& verts, std::vector<GLuint>& indices, BVHStats& stats) {
+    std::vector<BVHNode> nodes;
+    GLuint triangleCount = (GLuint)(indices.size() / 3);
+    stats = BVHStats();
+    if (triangleCount == 0) return nodes;
+
+    TriangleBVHBuilder builder;
+    builder.triangleBounds.resize(triangleCount);
+    builder.centroids.resize(triangleCount);
+    builder.order.resize(triangleCount);
+    builder.slots.resize(2 * triangleCount - 1);
+    std::iota(builder.order.begin(), builder.order.end(), 0);
+
+    unsigned threads = std::thread::hardware_concurrency();
+    while ((1u << builder.parallelDepth) < threads) builder.parallelDepth++;
+
+    for (GLuint t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = verts[indices[t * 3]].position;
+        const glm::vec3& b = verts[indices[t * 3 + 1]].position;
+        const glm::vec3& c = verts[indices[t * 3 + 2]].position;
+
+        builder.triangleBounds[t] = AABB{glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c))};
+        builder.centroids[t] = (a + b + c) / 3.0f;
+    }
+
+    GLuint root = builder.build(0, triangleCount, 0);
+
+    nodes.reserve(builder.nodeCount.load());
+    builder.flatten(root, 0, nodes, stats);
+
+    std::vector<GLuint> reordered(indices.size());
+    for (GLuint t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            reordered[t * 3 + k] = indices[builder.order[t] * 3 + k];
+    indices.swap(reordered);
+
+    stats.triangles = (int)triangleCount;
+    stats.sahCost = bvhSahCost(nodes);
+    return nodes;
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef CCD_H
+#define CCD_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+#include "collision.hpp"
+#include "broadphase.hpp"
+
+#define CCD_MOTION_RATIO 0.5f   // rápido: anda num passo mais que essa fração do menor lado da caixa
+#define CCD_MAX_SAMPLES 16      // poses testadas no trecho de sobreposição das caixas, antes da bisseção
+#define CCD_BISECTIONS 6        // refinamento do instante do impacto
+
+// Colisão contínua para corpos rápidos, entre a integração e a narrowphase.
+// A caixa varrida do início ao fim do passo é consultada na árvore de AABBs
+// da broadphase, sincronizada com as poses novas só quando há corpo rápido.
+// Contra cada candidato só o trecho do movimento em que as duas caixas se
+// sobrepõem é percorrido, em poses separadas por no máximo CCD_MOTION_RATIO
+// do corpo (nada mais grosso que isso fica entre duas poses), e o primeiro
+// toque é refinado por bisseção. Se o trecho pedir mais que CCD_MAX_SAMPLES
+// poses o espaçamento cresce e geometria fina pode passar entre elas: esses
+// corpos são contados em capped. O corpo volta para a primeira pose em
+// contato e a narrowphase do mesmo passo vê um contato raso. Só a translação
+// é varrida; o outro corpo fica na pose atual. A sala fica fora: o campo de
+// distância dela é negativo em todo o sólido e, sem ele,
+// checkCollisionWithSceneBounds prende a caixa dentro da sala.
+struct ContinuousCollision {
+    bool enabled = false;
+    int fastBodies = 0;  // no último passo
+    int clamped = 0;     // desses, quantos voltaram para o impacto
+    int capped = 0;      // desses, quantos tiveram as poses limitadas por CCD_MAX_SAMPLES
+
+    void begin(const std::vector<Model>& models);
+    void run(std::vector<Model>& models, DynamicAABBTree& tree, int bvhWidth, ContactMode contacts);
+
+private:
+    std::vector<glm::vec3> start;  // posição no início do passo, por modelo
+    std::vector<int> fast;         // corpos rápidos do passo
+    std::vector<AABB> bounds;      // caixas no fim do passo, para a árvore
+
+    float timeOfImpact(Model& a, const Model& b, const glm::vec3& motion, float enter, float exit, int samples, int bvhWidth, ContactMode contacts);
+};
+
+// Algum par de folhas se toca na pose atual? Para no primeiro.
+bool modelsTouch(const Model& a, const Model& b, int bvhWidth, ContactMode contacts) {
+    glm::mat4 aModelMatrix = a.effect * a.modelMatrix();
+    glm::mat4 bModelMatrix = b.effect * b.modelMatrix();
+
+    if (contacts == CONTACT_HULLS && !a.hulls.empty() && !b.hulls.empty()) {
+        for (const ConvexHull& aHull : a.hulls) {
+            if (aHull.points.empty()) continue;
+            HullShape aShape{&aHull, glm::mat3(aModelMatrix), glm::vec3(aModelMatrix[3])};
+            for (const ConvexHull& bHull : b.hulls) {
+                if (bHull.points.empty()) continue;
+                if (gjkIntersect(aShape, HullShape{&bHull, glm::mat3(bModelMatrix), glm::vec3(bModelMatrix[3])}))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    RelativeTransform relative(aModelMatrix, bModelMatrix);
+    glm::vec3 preferred = a.getCenterOfMass() - b.getCenterOfMass();
+    std::vector<ContactPoint> points;
+
+    for (size_t i = 0; i < a.meshes.size(); i++) {
+        for (size_t j = 0; j < b.meshes.size(); j++) {
+            auto leaf = [&](const BVHNode& aLeaf, const BVHNode& bLeaf) {
+                if (contacts == CONTACT_BOX) return true;
+                leafTriangleContacts(a.meshes[i], b.meshes[j], aLeaf, bLeaf, aModelMatrix, bModelMatrix, preferred, points);
+                return !points.empty();
+            };
+            if (meshTreeCollision(a.meshes[i], b.meshes[j], aModelMatrix, bModelMatrix, &relative, bvhWidth, nullptr, nullptr, leaf))
+                return true;
+        }
+    }
+    return false;
+}
+
+void ContinuousCollision::begin(const std::vector<Model>& models) {
+    if (!enabled) return;
+    start.resize(models.size());
+    for (size_t i = 0; i < models.size(); i++)
+        start[i] = models[i].transforms.position;
+}
+
+// Trecho [enter, exit] do passo em que box, levada de box - motion até box,
+// sobrepõe other; false se não chega a sobrepor
+static bool sweptOverlap(const AABB& box, const glm::vec3& motion, const AABB& other, float& enter, float& exit) {
+    enter = 0.0f;
+    exit = 1.0f;
+    for (int k = 0; k < 3; k++) {
+        float low = box.min_corner[k] - motion[k];
+        float high = box.max_corner[k] - motion[k];
+        if (motion[k] == 0.0f) {
+            if (high < other.min_corner[k] || low > other.max_corner[k]) return false;
+            continue;
+        }
+        float t0 = (other.min_corner[k] - high) / motion[k];
+        float t1 = (other.max_corner[k] - low) / motion[k];
+        if (t0 > t1) std::swap(t0, t1);
+        enter = glm::max(enter, t0);
+        exit = glm::min(exit, t1);
+    }
+    return enter <= exit;
+}
+
+// Fração do movimento no primeiro toque, 1 se não toca; as poses ficam em
+// [enter, exit], onde as caixas se sobrepõem. a é levado às poses testadas
+// e devolvido ao fim do passo; quem chama o posiciona depois.
+float ContinuousCollision::timeOfImpact(Model& a, const Model& b, const glm::vec3& motion, float enter, float exit, int samples, int bvhWidth, ContactMode contacts) {
+    glm::vec3 end = a.transforms.position;
+    auto touchesAt = [&](float t) {
+        a.translate(end - motion * (1.0f - t) - a.transforms.position);
+        return modelsTouch(a, b, bvhWidth, contacts);
+    };
+
+    float toi = 1.0f;
+    // já encostado no início: contato de repouso, fica com a narrowphase
+    if (enter > 0.0f || !touchesAt(0.0f)) {
+        float free = enter;
+        for (int k = enter > 0.0f ? 0 : 1; k <= samples; k++) {
+            float t = enter + (exit - enter) * k / samples;
+            if (!touchesAt(t)) {
+                free = t;
+                continue;
+            }
+
+            // antes de enter as caixas nem se sobrepõem
+            toi = t;
+            for (int i = 0; k > 0 && i < CCD_BISECTIONS; i++) {
+                float middle = 0.5f * (free + toi);
+                if (touchesAt(middle))
+                    toi = middle;
+                else
+                    free = middle;
+            }
+            break;
+        }
+    }
+
+    a.translate(end - a.transforms.position);
+    return toi;
+}
+
+void ContinuousCollision::run(std::vector<Model>& models, DynamicAABBTree& tree, int bvhWidth, ContactMode contacts) {
+    fastBodies = 0;
+    clamped = 0;
+    capped = 0;
+    if (!enabled) return;
+    PROFILE_FUNCTION();
+
+    fast.clear();
+    bounds.resize(models.size());
+    for (size_t i = 0; i < models.size(); i++) {
+        bounds[i] = models[i].getWorldAABB();
+        if (models[i].body.sleeping()) continue;
+
+        glm::vec3 size = bounds[i].max_corner - bounds[i].min_corner;
+        float step = CCD_MOTION_RATIO * glm::min(size.x, glm::min(size.y, size.z));
+        if (step > 0.0f && glm::length(models[i].transforms.position - start[i]) > step)
+            fast.push_back((int)i);
+    }
+    fastBodies = (int)fast.size();
+    if (fast.empty()) return;
+
+    tree.sync(bounds);
+
+    for (int i : fast) {
+        Model& model = models[i];
+        glm::vec3 motion = model.transforms.position - start[i];
+        const AABB& box = bounds[i];
+        glm::vec3 size = box.max_corner - box.min_corner;
+        float step = CCD_MOTION_RATIO * glm::min(size.x, glm::min(size.y, size.z));
+
+        AABB swept = box;
+        swept.min_corner = glm::min(box.min_corner, box.min_corner - motion);
+        swept.max_corner = glm::max(box.max_corner, box.max_corner - motion);
+        float distance = glm::length(motion);
+
+        // folhas gordas: confirma com a caixa justa antes de varrer
+        float toi = 1.0f;
+        bool limited = false;
+        tree.queryBox(swept, [&](int j) {
+            float enter, exit;
+            if (j == i || !sweptOverlap(box, motion, bounds[j], enter, exit) || enter >= toi)
+                return true;
+
+            int samples = glm::max((int)std::ceil((exit - enter) * distance / step), 1);
+            if (samples > CCD_MAX_SAMPLES) {
+                samples = CCD_MAX_SAMPLES;
+                limited = true;
+            }
+            toi = glm::min(toi, timeOfImpact(model, models[j], motion, enter, exit, samples, bvhWidth, contacts));
+            return true;
+        });
+        capped += limited;
+
+        if (toi < 1.0f) {
+            model.translate(-motion * (1.0f - toi));
+            bounds[i] = model.getWorldAABB();
+            tree.moveBody(i, bounds[i]);
+            clamped++;
+        }
+    }
+}
+
+#endif
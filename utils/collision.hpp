@@ -1,127 +1,580 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <map>
 #include "model.hpp"
-#include <stack>
+#include "broadphase.hpp"
+#include "contact.hpp"
+#include "gjk.hpp"
+#include "thread_pool.hpp"
 #define RESTITUTION 0.6f
 #define FRICTION 0.8f
 
-bool checkAABBCollision(const AABB &a, const AABB &b)
-{
-    return (a.min_corner.x <= b.max_corner.x && a.max_corner.x >= b.min_corner.x) &&
-           (a.min_corner.y <= b.max_corner.y && a.max_corner.y >= b.min_corner.y) &&
-           (a.min_corner.z <= b.max_corner.z && a.max_corner.z >= b.min_corner.z);
+// Como os nós das duas árvores são comparados durante a descida
+enum NarrowphaseMode {
+    NARROWPHASE_AABB,  // AABBs de mundo dos 8 cantos transformados, por nó
+    NARROWPHASE_OBB    // SAT no espaço de A com a transformação relativa
+};
+
+bool parseNarrowphaseMode(const std::string& name, NarrowphaseMode& mode) {
+    if (name == "aabb") mode = NARROWPHASE_AABB;
+    else if (name == "obb") mode = NARROWPHASE_OBB;
+    else return false;
+    return true;
 }
 
-bool recursiveAABBTreeCollision(
-    AABBNode* aRoot, AABBNode* bNode,
+const char* narrowphaseModeName(NarrowphaseMode mode) {
+    return mode == NARROWPHASE_AABB ? "aabb" : "obb";
+}
+
+// O que os pares de folhas produzem para a resposta
+enum ContactMode {
+    CONTACT_BOX,        // menor sobreposição das caixas das folhas, sem torque
+    CONTACT_TRIANGLES,  // SAT entre triângulos e manifold de até 4 pontos
+    CONTACT_HULLS       // GJK/EPA entre os hulls convexos de cada malha
+};
+
+bool parseContactMode(const std::string& name, ContactMode& mode) {
+    if (name == "box") mode = CONTACT_BOX;
+    else if (name == "tri") mode = CONTACT_TRIANGLES;
+    else if (name == "hull") mode = CONTACT_HULLS;
+    else return false;
+    return true;
+}
+
+const char* contactModeName(ContactMode mode) {
+    if (mode == CONTACT_BOX) return "box";
+    return mode == CONTACT_TRIANGLES ? "tri" : "hull";
+}
+
+// Resposta entre duas folhas: menor sobreposição das caixas no espaço do mundo
+bool leafPenetration(
+    const BVHNode& aNode, const BVHNode& bNode,
     const glm::mat4& aTransform,
     const glm::mat4& bTransform,
     glm::vec3& collisionNormal,
     float& penetrationDepth
 ) {
-    if (!aRoot || !bNode)
+    AABB aAABB = aNode.getTransformed(aTransform);
+    AABB bAABB = bNode.getTransformed(bTransform);
+
+    // Calcular penetração
+    float xPen = std::min(aAABB.max_corner.x, bAABB.max_corner.x) - std::max(aAABB.min_corner.x, bAABB.min_corner.x);
+    float yPen = std::min(aAABB.max_corner.y, bAABB.max_corner.y) - std::max(aAABB.min_corner.y, bAABB.min_corner.y);
+    float zPen = std::min(aAABB.max_corner.z, bAABB.max_corner.z) - std::max(aAABB.min_corner.z, bAABB.min_corner.z);
+
+    float minPen = std::min({xPen, yPen, zPen});
+    if (minPen <= 0.0f) return false;
+
+    penetrationDepth = minPen;
+
+    if (minPen == xPen) collisionNormal = glm::vec3(1, 0, 0);
+    else if (minPen == yPen) collisionNormal = glm::vec3(0, 1, 0);
+    else collisionNormal = glm::vec3(0, 0, 1);
+
+    return true;
+}
+
+#define TRAVERSAL_CACHE_MARGIN 0.005f  // folga da frente em cache, em fração da diagonal da raiz de A
+#define TRAVERSAL_CACHE_MIN_STEPS 4     // só monta a frente se o movimento por passo a deixa durar isso
+
+// Contadores das descidas nas BVHs (por passo ou acumulados)
+struct TraversalStats {
+    long queries = 0;     // pares de malhas consultados
+    long cacheHits = 0;   // consultas respondidas pela frente em cache
+    long nodeTests = 0;   // pares de nós testados na descida
+    long leafTests = 0;   // pares de folhas testados
+
+    void add(const TraversalStats& other);
+    float hitRate() const { return queries ? (float)cacheHits / queries : 0.0f; }
+};
+
+void TraversalStats::add(const TraversalStats& other) {
+    queries += other.queries;
+    cacheHits += other.cacheHits;
+    nodeTests += other.nodeTests;
+    leafTests += other.leafTests;
+}
+
+// Descida simultânea nas duas árvores; overlaps(aNode, bNode) decide se o par
+// é expandido e leaf(aLeaf, bLeaf) recebe os pares de folhas (true = parar)
+template<typename Overlap, typename Leaf>
+bool traverseTreePair(
+    const std::vector<BVHNode>& aTree, const std::vector<BVHNode>& bTree,
+    const Overlap& overlaps,
+    const Leaf& leaf,
+    TraversalStats* stats = nullptr
+) {
+    if (aTree.empty() || bTree.empty())
         return false;
 
-    std::stack<std::pair<AABBNode*, AABBNode*>> stack;
-    stack.push({aRoot, bNode});
+    // pilha fixa de pares de índices: nada é alocado por teste
+    std::pair<GLuint, GLuint> stack[BVH_PAIR_STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, 0};
 
-    while (!stack.empty()) {
-        auto [aNode, bNode] = stack.top();
-        stack.pop();
+    while (top > 0) {
+        auto [a, b] = stack[--top];
+        const BVHNode& aNode = aTree[a];
+        const BVHNode& bNode = bTree[b];
 
-        // Obter AABB transformadas inline
-        AABB aAABB = aNode->getTransformed(aTransform);
-        AABB bAABB = bNode->getTransformed(bTransform);
+        if (stats) stats->nodeTests++;
+        if (!overlaps(aNode, bNode))
+            continue;
 
-        if (!checkAABBCollision(aAABB, bAABB))
+        if (aNode.isLeaf() && bNode.isLeaf()) {
+            if (stats) stats->leafTests++;
+            if (leaf(aNode, bNode))
+                return true;
             continue;
+        }
+
+        // Expandir nós filhos (esquerdo = índice + 1, direito = offset)
+        if (!aNode.isLeaf() && !bNode.isLeaf()) {
+            stack[top++] = {a + 1, b + 1};
+            stack[top++] = {a + 1, bNode.offset};
+            stack[top++] = {aNode.offset, b + 1};
+            stack[top++] = {aNode.offset, bNode.offset};
+        }
+        else if (!aNode.isLeaf()) {
+            stack[top++] = {a + 1, b};
+            stack[top++] = {aNode.offset, b};
+        }
+        else if (!bNode.isLeaf()) {
+            stack[top++] = {a, b + 1};
+            stack[top++] = {a, bNode.offset};
+        }
+    }
+
+    return false;
+}
+
+template<typename Leaf>
+bool recursiveAABBTreeCollision(
+    const std::vector<BVHNode>& aTree, const std::vector<BVHNode>& bTree,
+    const glm::mat4& aTransform,
+    const glm::mat4& bTransform,
+    const Leaf& leaf,
+    TraversalStats* stats = nullptr
+) {
+    auto overlaps = [&](const BVHNode& aNode, const BVHNode& bNode) {
+        return checkAABBCollision(aNode.getTransformed(aTransform), bNode.getTransformed(bTransform));
+    };
+    return traverseTreePair(aTree, bTree, overlaps, leaf, stats);
+}
 
-        if (aNode->isLeaf() && bNode->isLeaf()) {
-            // Calcular penetração
-            float xPen = std::min(aAABB.max_corner.x, bAABB.max_corner.x) - std::max(aAABB.min_corner.x, bAABB.min_corner.x);
-            float yPen = std::min(aAABB.max_corner.y, bAABB.max_corner.y) - std::max(aAABB.min_corner.y, bAABB.min_corner.y);
-            float zPen = std::min(aAABB.max_corner.z, bAABB.max_corner.z) - std::max(aAABB.min_corner.z, bAABB.min_corner.z);
+// relative = RelativeTransform(aTransform, bTransform), montada uma vez por par de modelos
+template<typename Leaf>
+bool relativeOBBTreeCollision(
+    const std::vector<BVHNode>& aTree, const std::vector<BVHNode>& bTree,
+    const RelativeTransform& relative,
+    const Leaf& leaf,
+    TraversalStats* stats = nullptr
+) {
+    auto overlaps = [&](const BVHNode& aNode, const BVHNode& bNode) {
+        return relative.overlaps(aNode, bNode);
+    };
+    return traverseTreePair(aTree, bTree, overlaps, leaf, stats);
+}
 
-            float minPen = std::min({xPen, yPen, zPen});
-            if (minPen <= 0.0f) continue;
+// Árvore larga de A contra a binária de B, no espaço de A. Cada nó de B é
+// testado contra todos os filhos do nó largo de uma vez nos 6 eixos de face
+// do SAT (obbOverlapMask); os eixos de aresta ficam para os pares de folhas.
+// Desce o lado maior; quando é B, a entrada da pilha leva a máscara dos
+// filhos de A que ainda podem tocar aquela subárvore.
+template<int W, typename Leaf>
+bool wideTreeCollision(
+    const WideBVH<W>& aTree, const std::vector<BVHNode>& bTree,
+    const RelativeTransform& relative,
+    const Leaf& leaf,
+    TraversalStats* stats = nullptr
+) {
+    if (aTree.nodes.empty() || bTree.empty())
+        return false;
 
-            penetrationDepth = minPen;
+    struct Entry {
+        GLuint a;
+        GLuint b;
+        int mask;
+    };
+
+    Entry stack[WIDE_BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, 0, (1 << W) - 1};
+
+    while (top > 0) {
+        Entry entry = stack[--top];
+        const WideBVHNode<W>& aNode = aTree.nodes[entry.a];
+        const BVHNode& bNode = bTree[entry.b];
+        if (stats) stats->nodeTests++;
+
+        glm::vec3 bHalf = (bNode.max_corner - bNode.min_corner) * 0.5f;
+        glm::vec3 bCenter = relative.rotation * ((bNode.min_corner + bNode.max_corner) * 0.5f) + relative.translation;
+        glm::vec3 bRadius = relative.absRotation * bHalf;
+        int mask = aTree.obbOverlapMask(aNode, relative, bCenter, bRadius, bHalf) & entry.mask;
+
+        // filhos de A que esperam B descer: folhas, ou caixas menores que a de B
+        int deferMask = 0;
+        float bArea = bNode.isLeaf() ? 0.0f : aabbSurfaceArea(AABB{bCenter - bRadius, bCenter + bRadius});
+
+        for (int i = 0; i < W; i++) {
+            if (!(mask & (1 << i)) || aNode.isEmpty(i)) continue;
+
+            if (!aNode.isLeaf(i)) {
+                if (bArea > aabbSurfaceArea(aNode.box(i)))
+                    deferMask |= 1 << i;
+                else
+                    stack[top++] = {aNode.child[i], entry.b, (1 << W) - 1};
+                continue;
+            }
 
-            if (minPen == xPen) collisionNormal = glm::vec3(1, 0, 0);
-            else if (minPen == yPen) collisionNormal = glm::vec3(0, 1, 0);
-            else collisionNormal = glm::vec3(0, 0, 1);
+            if (!bNode.isLeaf()) {
+                deferMask |= 1 << i;
+                continue;
+            }
 
-            return true;
+            // os eixos de aresta só entram no par de folhas
+            BVHNode aLeaf{aNode.box(i).min_corner, aNode.child[i], aNode.box(i).max_corner, aNode.count[i]};
+            if (stats) stats->leafTests++;
+            if (relative.overlaps(aLeaf, bNode) && leaf(aLeaf, bNode))
+                return true;
         }
 
-        // Expandir nós filhos
-        if (!aNode->isLeaf() && !bNode->isLeaf()) {
-            stack.push({aNode->left, bNode->left});
-            stack.push({aNode->left, bNode->right});
-            stack.push({aNode->right, bNode->left});
-            stack.push({aNode->right, bNode->right});
+        // B desce pelos filhos (esquerdo = índice + 1, direito = offset)
+        if (deferMask) {
+            stack[top++] = {entry.a, entry.b + 1, deferMask};
+            stack[top++] = {entry.a, bNode.offset, deferMask};
         }
-        else if (!aNode->isLeaf()) {
-            stack.push({aNode->left, bNode});
-            stack.push({aNode->right, bNode});
+    }
+
+    return false;
+}
+
+// Maior deslocamento, no espaço de A, de um canto de box entre a relativa
+// (rotation, translation) e a atual. O deslocamento é afim no ponto, então o
+// máximo do módulo na caixa está em um dos cantos.
+float relativeDisplacement(const glm::mat3& rotation, const glm::vec3& translation, const RelativeTransform& relative, const AABB& box) {
+    float maxDistance2 = 0.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner(
+            i & 1 ? box.max_corner.x : box.min_corner.x,
+            i & 2 ? box.max_corner.y : box.min_corner.y,
+            i & 4 ? box.max_corner.z : box.min_corner.z
+        );
+        glm::vec3 moved = (relative.rotation * corner + relative.translation) - (rotation * corner + translation);
+        maxDistance2 = std::max(maxDistance2, glm::dot(moved, moved));
+    }
+    return std::sqrt(maxDistance2);
+}
+
+// Frente de um par de malhas: os pares de folhas que se sobrepunham com as
+// caixas de A infladas por margin, na transformação relativa em que foram
+// encontrados. Enquanto nenhum ponto de B andou mais que margin no espaço de
+// A, nenhum outro par de folhas pode se tocar e a descida é pulada.
+struct MeshPairCache {
+    glm::mat3 rotation = glm::mat3(1.0f);
+    glm::vec3 translation = glm::vec3(0.0f);
+    float margin = 0.0f;
+    bool valid = false;
+    std::vector<std::pair<GLuint, GLuint>> leafPairs;
+
+    // consulta anterior, para estimar o movimento por passo
+    glm::mat3 lastRotation = glm::mat3(1.0f);
+    glm::vec3 lastTranslation = glm::vec3(0.0f);
+    float motion = FLT_MAX;
+
+    bool update(const RelativeTransform& relative, const AABB& aRoot, const AABB& bRoot);
+};
+
+// Registra o passo e diz se vale usar a frente: ela ainda cobre a relativa
+// atual, ou o par anda devagar o bastante para uma nova durar alguns passos
+bool MeshPairCache::update(const RelativeTransform& relative, const AABB& aRoot, const AABB& bRoot) {
+    if (margin == 0.0f)
+        margin = TRAVERSAL_CACHE_MARGIN * glm::length(aRoot.max_corner - aRoot.min_corner);
+    else
+        motion = relativeDisplacement(lastRotation, lastTranslation, relative, bRoot);
+    lastRotation = relative.rotation;
+    lastTranslation = relative.translation;
+
+    valid = valid && relativeDisplacement(rotation, translation, relative, bRoot) <= margin;
+    return valid || motion * TRAVERSAL_CACHE_MIN_STEPS <= margin;
+}
+
+// Descida OBB pela frente em cache (depois de cache.update); os pares
+// guardados passam pelo mesmo teste exato de relativeOBBTreeCollision, então
+// o resultado é o mesmo de descer da raiz.
+template<typename Leaf>
+bool cachedOBBTreeCollision(
+    const std::vector<BVHNode>& aTree, const std::vector<BVHNode>& bTree,
+    const RelativeTransform& relative,
+    MeshPairCache& cache,
+    const Leaf& leaf,
+    TraversalStats* stats = nullptr
+) {
+    if (cache.valid) {
+        if (stats) stats->cacheHits++;
+    } else {
+        cache.rotation = relative.rotation;
+        cache.translation = relative.translation;
+        cache.leafPairs.clear();
+
+        glm::vec3 margin(cache.margin);
+        auto fatOverlaps = [&](const BVHNode& aNode, const BVHNode& bNode) {
+            BVHNode fat = aNode;
+            fat.min_corner -= margin;
+            fat.max_corner += margin;
+            return relative.overlaps(fat, bNode);
+        };
+        auto collect = [&](const BVHNode& aLeaf, const BVHNode& bLeaf) {
+            cache.leafPairs.push_back({(GLuint)(&aLeaf - aTree.data()), (GLuint)(&bLeaf - bTree.data())});
+            return false;
+        };
+
+        // só os nós contam aqui: os pares de folhas são testados logo abaixo
+        TraversalStats rebuild;
+        traverseTreePair(aTree, bTree, fatOverlaps, collect, &rebuild);
+        if (stats) stats->nodeTests += rebuild.nodeTests;
+        cache.valid = true;
+    }
+
+    for (auto [a, b] : cache.leafPairs) {
+        if (stats) stats->leafTests++;
+        if (relative.overlaps(aTree[a], bTree[b]) && leaf(aTree[a], bTree[b]))
+            return true;
+    }
+    return false;
+}
+
+// Par de malhas no modo escolhido; as árvores largas e o cache só existem no
+// modo OBB. A frente em cache é montada na árvore binária; pares que andam
+// rápido demais para ela durar descem da raiz como sem cache.
+template<typename Leaf>
+bool meshTreeCollision(
+    const Mesh& meshA, const Mesh& meshB,
+    const glm::mat4& aTransform,
+    const glm::mat4& bTransform,
+    const RelativeTransform* relative,
+    int bvhWidth,
+    MeshPairCache* cache,
+    TraversalStats* stats,
+    const Leaf& leaf
+) {
+    if (stats) stats->queries++;
+
+    bool cached = relative && cache && !meshA.boundingTree.empty() && !meshB.boundingTree.empty() &&
+                  cache->update(*relative, meshA.boundingTree[0].box(), meshB.boundingTree[0].box());
+
+    if (cached)
+        return cachedOBBTreeCollision(meshA.boundingTree, meshB.boundingTree, *relative, *cache, leaf, stats);
+    if (relative && bvhWidth == 8)
+        return wideTreeCollision(meshA.wideTree8, meshB.boundingTree, *relative, leaf, stats);
+    if (relative && bvhWidth == 4)
+        return wideTreeCollision(meshA.wideTree4, meshB.boundingTree, *relative, leaf, stats);
+    if (relative)
+        return relativeOBBTreeCollision(meshA.boundingTree, meshB.boundingTree, *relative, leaf, stats);
+    return recursiveAABBTreeCollision(meshA.boundingTree, meshB.boundingTree, aTransform, bTransform, leaf, stats);
+}
+
+// Primeiro par de folhas que se toca, com a resposta por caixas
+bool meshTreeCollision(
+    const Mesh& meshA, const Mesh& meshB,
+    const glm::mat4& aTransform,
+    const glm::mat4& bTransform,
+    const RelativeTransform* relative,
+    int bvhWidth,
+    MeshPairCache* cache,
+    TraversalStats* stats,
+    glm::vec3& collisionNormal,
+    float& penetrationDepth
+) {
+    auto leaf = [&](const BVHNode& aLeaf, const BVHNode& bLeaf) {
+        return leafPenetration(aLeaf, bLeaf, aTransform, bTransform, collisionNormal, penetrationDepth);
+    };
+    return meshTreeCollision(meshA, meshB, aTransform, bTransform, relative, bvhWidth, cache, stats, leaf);
+}
+
+// Triângulos de um par de folhas no mundo: cada triângulo de A contra lotes
+// de CONTACT_BATCH triângulos de B (triangleBatchMask), e o SAT exato só
+// nos que sobrevivem. preferred orienta as normais de B para A.
+void leafTriangleContacts(
+    const Mesh& meshA, const Mesh& meshB,
+    const BVHNode& aLeaf, const BVHNode& bLeaf,
+    const glm::mat4& aTransform,
+    const glm::mat4& bTransform,
+    const glm::vec3& preferred,
+    std::vector<ContactPoint>& contacts
+) {
+    TriangleBatch batches[(BVH_MAX_LEAF_TRIANGLES + CONTACT_BATCH - 1) / CONTACT_BATCH];
+    int batchCount = 0;
+
+    // folhas acima do limite só aparecem com centróides idênticos: processa em blocos
+    for (GLuint bFirst = bLeaf.offset; bFirst < bLeaf.offset + bLeaf.triangleCount; bFirst += BVH_MAX_LEAF_TRIANGLES) {
+        GLuint bEnd = std::min(bFirst + BVH_MAX_LEAF_TRIANGLES, bLeaf.offset + bLeaf.triangleCount);
+
+        batchCount = 0;
+        for (GLuint t = bFirst; t < bEnd; t++) {
+            if ((t - bFirst) % CONTACT_BATCH == 0)
+                batches[batchCount++].count = 0;
+
+            glm::vec3 a, b, c;
+            meshB.getTriangle(t, a, b, c);
+            TriangleBatch& batch = batches[batchCount - 1];
+            batch.set(batch.count++,
+                      glm::vec3(bTransform * glm::vec4(a, 1.0f)),
+                      glm::vec3(bTransform * glm::vec4(b, 1.0f)),
+                      glm::vec3(bTransform * glm::vec4(c, 1.0f)));
         }
-        else if (!bNode->isLeaf()) {
-            stack.push({aNode, bNode->left});
-            stack.push({aNode, bNode->right});
+
+        for (GLuint t = aLeaf.offset; t < aLeaf.offset + aLeaf.triangleCount; t++) {
+            glm::vec3 tri[3];
+            meshA.getTriangle(t, tri[0], tri[1], tri[2]);
+            for (glm::vec3& v : tri)
+                v = glm::vec3(aTransform * glm::vec4(v, 1.0f));
+
+            for (int k = 0; k < batchCount; k++) {
+                int mask = triangleBatchMask(batches[k], tri);
+                while (mask) {
+                    int lane = __builtin_ctz(mask);
+                    mask &= mask - 1;
+
+                    glm::vec3 other[3];
+                    batches[k].triangle(lane, other);
+                    ContactPoint points[TRIANGLE_CONTACT_MAX_POINTS];
+                    int count = triangleContact(tri, other, preferred, points);
+                    contacts.insert(contacts.end(), points, points + count);
+                }
+            }
         }
     }
+}
 
-    return false;
+// Todos os pares de triângulos em contato entre duas malhas
+void meshTriangleContacts(
+    const Mesh& meshA, const Mesh& meshB,
+    const glm::mat4& aTransform,
+    const glm::mat4& bTransform,
+    const RelativeTransform* relative,
+    int bvhWidth,
+    MeshPairCache* cache,
+    TraversalStats* stats,
+    const glm::vec3& preferred,
+    std::vector<ContactPoint>& contacts
+) {
+    auto leaf = [&](const BVHNode& aLeaf, const BVHNode& bLeaf) {
+        leafTriangleContacts(meshA, meshB, aLeaf, bLeaf, aTransform, bTransform, preferred, contacts);
+        return false;
+    };
+    meshTreeCollision(meshA, meshB, aTransform, bTransform, relative, bvhWidth, cache, stats, leaf);
+}
+
+// Frentes em cache por par de modelos (uma por par de malhas) e os contadores.
+// Pares que não passaram pela narrowphase no passo são descartados em endStep.
+// touch cria e marca a entrada (serial); find só consulta, então vários pares
+// distintos podem usar o cache ao mesmo tempo depois do touch de todos.
+struct TraversalCache {
+    bool enabled = true;
+    TraversalStats step;       // passo corrente da física
+    TraversalStats lastStep;
+    TraversalStats total;
+
+    void touch(const Model& a, const Model& b);
+    MeshPairCache* find(const Model& a, const Model& b, size_t meshA, size_t meshB);
+    void endStep();
+
+private:
+    struct Entry {
+        std::vector<MeshPairCache> meshes;
+        bool touched = false;
+    };
+    std::map<std::pair<const Model*, const Model*>, Entry> pairs;
+};
+
+void TraversalCache::touch(const Model& a, const Model& b) {
+    if (!enabled) return;
+
+    Entry& entry = pairs[{&a, &b}];
+    if (entry.meshes.empty())
+        entry.meshes.resize(a.meshes.size() * b.meshes.size());
+    entry.touched = true;
+}
+
+MeshPairCache* TraversalCache::find(const Model& a, const Model& b, size_t meshA, size_t meshB) {
+    if (!enabled) return nullptr;
+
+    auto it = pairs.find({&a, &b});
+    if (it == pairs.end()) return nullptr;
+    return &it->second.meshes[meshA * b.meshes.size() + meshB];
+}
+
+void TraversalCache::endStep() {
+    for (auto it = pairs.begin(); it != pairs.end();) {
+        if (!it->second.touched) {
+            it = pairs.erase(it);
+        } else {
+            it->second.touched = false;
+            ++it;
+        }
+    }
+
+    total.add(step);
+    lastStep = step;
+    step = TraversalStats();
 }
 
 void checkCollisionWithSceneBounds(Model &model, const AABB &sceneAABB)
 {
+    PROFILE_FUNCTION();
     AABB modelAABB = model.getGlobalAABB();
 
     glm::vec3 correction(0.0f);
+    glm::vec3 velocity = model.body.velocity();
 
     // X axis
-    if (modelAABB.min_corner.x < sceneAABB.min_corner.x && model.object.velocity.x < 0.0f)
+    if (modelAABB.min_corner.x < sceneAABB.min_corner.x && velocity.x < 0.0f)
     {
         correction.x = sceneAABB.min_corner.x - modelAABB.min_corner.x;
-        model.object.velocity.x *= -RESTITUTION;
+        velocity.x *= -RESTITUTION;
     }
-    else if (modelAABB.max_corner.x > sceneAABB.max_corner.x && model.object.velocity.x > 0.0f)
+    else if (modelAABB.max_corner.x > sceneAABB.max_corner.x && velocity.x > 0.0f)
     {
         correction.x = sceneAABB.max_corner.x - modelAABB.max_corner.x;
-        model.object.velocity.x *= -RESTITUTION;
+        velocity.x *= -RESTITUTION;
     }
 
     // Y axis
-    if (modelAABB.min_corner.y < sceneAABB.min_corner.y && model.object.velocity.y < 0.0f)
+    if (modelAABB.min_corner.y < sceneAABB.min_corner.y && velocity.y < 0.0f)
     {
         correction.y = sceneAABB.min_corner.y - modelAABB.min_corner.y;
-        model.object.velocity.y *= -RESTITUTION;
+        velocity.y *= -RESTITUTION;
 
-        model.object.velocity.x *= FRICTION;
-        model.object.velocity.z *= FRICTION;
+        velocity.x *= FRICTION;
+        velocity.z *= FRICTION;
 
-        if (glm::abs(model.object.velocity.y) < 0.1f)
+        if (glm::abs(velocity.y) < 0.1f)
         {
-            model.object.velocity.y = 0.0f;
+            velocity.y = 0.0f;
         }
     }
-    else if (modelAABB.max_corner.y > sceneAABB.max_corner.y && model.object.velocity.y > 0.0f)
+    else if (modelAABB.max_corner.y > sceneAABB.max_corner.y && velocity.y > 0.0f)
     {
         correction.y = sceneAABB.max_corner.y - modelAABB.max_corner.y;
-        model.object.velocity.y *= -RESTITUTION;
+        velocity.y *= -RESTITUTION;
     }
 
     // Z axis
-    if (modelAABB.min_corner.z < sceneAABB.min_corner.z && model.object.velocity.z < 0.0f)
+    if (modelAABB.min_corner.z < sceneAABB.min_corner.z && velocity.z < 0.0f)
     {
         correction.z = sceneAABB.min_corner.z - modelAABB.min_corner.z;
-        model.object.velocity.z *= -1.0f;
+        velocity.z *= -1.0f;
     }
-    else if (modelAABB.max_corner.z > sceneAABB.max_corner.z && model.object.velocity.z > 0.0f)
+    else if (modelAABB.max_corner.z > sceneAABB.max_corner.z && velocity.z > 0.0f)
     {
         correction.z = sceneAABB.max_corner.z - modelAABB.max_corner.z;
-        model.object.velocity.z *= -1.0f;
+        velocity.z *= -1.0f;
     }
 
+    model.body.setVelocity(velocity);
+
     // Corrigir posição se necessário
     if (glm::length(correction) > 0.0f)
     {
@@ -129,81 +582,183 @@ void checkCollisionWithSceneBounds(Model &model, const AABB &sceneAABB)
     }
 }
 
-bool modelsCollided(Model &a, Model &b) {
-    glm::mat4 aModelMatrix = a.effect * a.model;
-    glm::mat4 bModelMatrix = b.effect * b.model;
+// Manifold entre dois modelos: candidatos de todas as malhas, reduzidos a 4 pontos
+bool modelContactManifold(const Model &a, const Model &b, NarrowphaseMode mode, int bvhWidth, ContactManifold& manifold, TraversalCache* cache = nullptr, TraversalStats* stats = nullptr) {
+    glm::mat4 aModelMatrix = a.effect * a.modelMatrix();
+    glm::mat4 bModelMatrix = b.effect * b.modelMatrix();
+    RelativeTransform relative(aModelMatrix, bModelMatrix);
+    const RelativeTransform* relativePtr = mode == NARROWPHASE_OBB ? &relative : nullptr;
 
-    bool collided = false;
-    float penetration = 0.0f;
+    glm::vec3 preferred = a.getCenterOfMass() - b.getCenterOfMass();
+    std::vector<ContactPoint> contacts;
 
-    for (const auto& meshA : a.meshes) {
-        for (const auto& meshB : b.meshes) {
-            glm::vec3 localNormal;
-            float localPenetration;
+    for (size_t i = 0; i < a.meshes.size(); i++) {
+        for (size_t j = 0; j < b.meshes.size(); j++) {
+            MeshPairCache* meshCache = cache && relativePtr ? cache->find(a, b, i, j) : nullptr;
+            meshTriangleContacts(a.meshes[i], b.meshes[j], aModelMatrix, bModelMatrix, relativePtr, bvhWidth, meshCache, stats, preferred, contacts);
+        }
+    }
 
-            if (recursiveAABBTreeCollision(meshA.boundingTree, meshB.boundingTree, aModelMatrix, bModelMatrix, localNormal, localPenetration)) {
-                if (!collided || localPenetration > penetration) {
-                    penetration = localPenetration;
-                    collided = true;
-                }
-            }
+    manifold.reduce(contacts);
+    return manifold.count > 0;
+}
+
+// Manifold pelos hulls: as caixas dos hulls no mundo cortam os pares de
+// malhas distantes e GJK/EPA dá normal, profundidade e pontos dos que tocam.
+// Uma consulta por par de hulls, sem BVH nem triângulos.
+bool hullContactManifold(const Model &a, const Model &b, ContactManifold& manifold, TraversalStats* stats = nullptr) {
+    glm::mat4 aModelMatrix = a.effect * a.modelMatrix();
+    glm::mat4 bModelMatrix = b.effect * b.modelMatrix();
+    std::vector<ContactPoint> contacts;
+
+    for (const ConvexHull& aHull : a.hulls) {
+        if (aHull.points.empty()) continue;
+        HullShape aShape{&aHull, glm::mat3(aModelMatrix), glm::vec3(aModelMatrix[3])};
+        AABB aBox = transformAABB(aHull.box, aModelMatrix);
+
+        for (const ConvexHull& bHull : b.hulls) {
+            if (bHull.points.empty()) continue;
+            if (!checkAABBCollision(aBox, transformAABB(bHull.box, bModelMatrix))) continue;
+            if (stats) stats->queries++;
+
+            HullShape bShape{&bHull, glm::mat3(bModelMatrix), glm::vec3(bModelMatrix[3])};
+            HullPenetration penetration;
+            if (gjkIntersect(aShape, bShape, &penetration))
+                hullFaceContacts(aShape, bShape, penetration, contacts);
         }
     }
 
-    return collided;
+    manifold.reduce(contacts);
+    return manifold.count > 0;
 }
 
-void handleModelCollisionPrecise(Model &a, Model &b) {
-    glm::mat4 aModelMatrix = a.effect * a.model;
-    glm::mat4 bModelMatrix = b.effect * b.model;
+// Caixa do modelo como sólido uniforme: tensor diagonal nos eixos do corpo,
+// levado ao mundo pela orientação (R * diag(1/I) * Rᵀ)
+glm::mat3 bodyInverseInertia(const Model &m) {
+    glm::vec3 size = (m.modelAABB.max_corner - m.modelAABB.min_corner) * glm::abs(m.transforms.scale);
+    glm::vec3 size2 = size * size;
 
-    bool collided = false;
-    glm::vec3 collisionNormal(0.0f);
-    float penetration = 0.0f;
+    glm::vec3 inertia = m.body.mass() / 12.0f * glm::vec3(size2.y + size2.z, size2.x + size2.z, size2.x + size2.y);
+    glm::mat3 local(0.0f);
+    local[0][0] = inertia.x > 0.0f ? 1.0f / inertia.x : 0.0f;
+    local[1][1] = inertia.y > 0.0f ? 1.0f / inertia.y : 0.0f;
+    local[2][2] = inertia.z > 0.0f ? 1.0f / inertia.z : 0.0f;
+
+    glm::mat3 rotation = glm::mat3_cast(m.transforms.orientation);
+    return rotation * local * glm::transpose(rotation);
+}
+
+// Só lê os modelos, mas modelMatrix() refaz o cache da matriz se o modelo
+// mudou: pode rodar em paralelo desde que as matrizes dos dois já estejam em
+// dia e o cache já tenha recebido touch do par. stats recebe os contadores.
+bool detectModelContact(const Model &a, const Model &b, NarrowphaseMode mode, int bvhWidth, ContactMode contacts, ContactManifold& manifold, TraversalCache* cache = nullptr, TraversalStats* stats = nullptr) {
+    // modelos sem hull (malha vazia) ficam com os triângulos
+    if (contacts == CONTACT_HULLS && !a.hulls.empty() && !b.hulls.empty())
+        return hullContactManifold(a, b, manifold, stats);
+    if (contacts != CONTACT_BOX)
+        return modelContactManifold(a, b, mode, bvhWidth, manifold, cache, stats);
+
+    glm::mat4 aModelMatrix = a.effect * a.modelMatrix();
+    glm::mat4 bModelMatrix = b.effect * b.modelMatrix();
+    RelativeTransform relative(aModelMatrix, bModelMatrix);
+    const RelativeTransform* relativePtr = mode == NARROWPHASE_OBB ? &relative : nullptr;
 
-    for (const auto& meshA : a.meshes) {
-        for (const auto& meshB : b.meshes) {
+    bool collided = false;
+    for (size_t i = 0; i < a.meshes.size(); i++) {
+        for (size_t j = 0; j < b.meshes.size(); j++) {
             glm::vec3 localNormal;
             float localPenetration;
+            MeshPairCache* meshCache = cache && relativePtr ? cache->find(a, b, i, j) : nullptr;
 
-            if (recursiveAABBTreeCollision(meshA.boundingTree, meshB.boundingTree, aModelMatrix, bModelMatrix, localNormal, localPenetration)) {
-                if (!collided || localPenetration > penetration) {
-                    collisionNormal = localNormal;
-                    penetration = localPenetration;
+            if (meshTreeCollision(a.meshes[i], b.meshes[j], aModelMatrix, bModelMatrix, relativePtr, bvhWidth, meshCache, stats, localNormal, localPenetration)) {
+                if (!collided || localPenetration > manifold.depth) {
+                    manifold.normal = localNormal;
+                    manifold.depth = localPenetration;
                     collided = true;
                 }
             }
         }
     }
+    if (!collided) return false;
 
-    if (!collided) return;
-
-    // Corrige direção do vetor de colisão
+    // Corrige direção do vetor de colisão (no manifold já vem de B para A)
     glm::vec3 delta = a.getPosition() - b.getPosition();
-    if (glm::dot(delta, collisionNormal) < 0.0f)
-        collisionNormal = -collisionNormal;
-
-    glm::vec3 correction = collisionNormal * penetration;
-
-    // Corrige posição com base na massa
-    float totalMass = a.object.mass + b.object.mass;
-    float aWeight = b.object.mass / totalMass;
-    float bWeight = a.object.mass / totalMass;
-
-    a.translate(correction * aWeight);
-    b.translate(-correction * bWeight);
+    if (glm::dot(delta, manifold.normal) < 0.0f)
+        manifold.normal = -manifold.normal;
+    return true;
+}
 
-    // Aplica impulso
-    glm::vec3 relativeVelocity = a.object.velocity - b.object.velocity;
-    float separatingVelocity = glm::dot(relativeVelocity, collisionNormal);
+// Manifold de um par candidato, guardado com o índice do par
+struct PairContact {
+    int pair;
+    ContactManifold manifold;
+};
+
+// Narrowphase paralela: todos os pares são detectados contra as mesmas
+// posições, cada worker no seu buffer; os buffers são juntados em ordem de
+// par para o ContactSolver. O resultado não depende do número de threads nem
+// de quem roubou qual par.
+struct ParallelNarrowphase {
+    explicit ParallelNarrowphase(int threads);
+
+    int threads() const { return pool.size(); }
+    void run(const std::vector<Model>& models, const std::vector<BroadphasePair>& pairs, NarrowphaseMode mode, int bvhWidth, ContactMode contacts, TraversalCache* cache);
+
+    double detectMs = 0.0;  // fase paralela do último run
+    const std::vector<PairContact>& contacts() const { return merged; }  // do último run, por par
+
+private:
+    struct alignas(64) WorkerBuffer {
+        std::vector<PairContact> contacts;
+        TraversalStats stats;
+    };
+
+    WorkStealingPool pool;
+    std::vector<WorkerBuffer> buffers;
+    std::vector<PairContact> merged;
+};
+
+ParallelNarrowphase::ParallelNarrowphase(int threads): pool(threads), buffers(pool.size()) {
+}
 
-    if (separatingVelocity < 0.0f) {
-        float impulse = -(1.0f + RESTITUTION) * separatingVelocity;
-        impulse /= (1.0f / a.object.mass + 1.0f / b.object.mass);
+void ParallelNarrowphase::run(const std::vector<Model>& models, const std::vector<BroadphasePair>& pairs, NarrowphaseMode mode, int bvhWidth, ContactMode contacts, TraversalCache* cache) {
+    PROFILE_FUNCTION();
+
+    // matrizes em dia antes das threads: um corpo corrigido pelo solver e
+    // posto para dormir no mesmo passo chega aqui com o cache sujo, e dois
+    // pares com ele o refariam ao mesmo tempo
+    for (const BroadphasePair& pair : pairs) {
+        models[pair.a].modelMatrix();
+        models[pair.b].modelMatrix();
+        if (cache)
+            cache->touch(models[pair.a], models[pair.b]);
+    }
 
-        glm::vec3 impulseVec = collisionNormal * impulse;
+    for (WorkerBuffer& buffer : buffers) {
+        buffer.contacts.clear();
+        buffer.stats = TraversalStats();
+    }
 
-        a.object.velocity += impulseVec / a.object.mass;
-        b.object.velocity -= impulseVec / b.object.mass;
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor((int)pairs.size(), [&](int index, int worker) {
+        PROFILE_SCOPE("detect pair");
+        const BroadphasePair& pair = pairs[index];
+        WorkerBuffer& buffer = buffers[worker];
+
+        PairContact contact;
+        contact.pair = index;
+        if (detectModelContact(models[pair.a], models[pair.b], mode, bvhWidth, contacts, contact.manifold, cache, &buffer.stats))
+            buffer.contacts.push_back(contact);
+    });
+    detectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    merged.clear();
+    for (const WorkerBuffer& buffer : buffers) {
+        merged.insert(merged.end(), buffer.contacts.begin(), buffer.contacts.end());
+        if (cache)
+            cache->step.add(buffer.stats);
     }
+    std::sort(merged.begin(), merged.end(), [](const PairContact& x, const PairContact& y) { return x.pair < y.pair; });
 }
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include "bvh.hpp"
+#include "wide_bvh.hpp"
+
+#define MANIFOLD_MAX_POINTS 4
+#define CONTACT_BATCH 8                   // triângulos de B por teste (1 AVX2 ou 2 SSE)
+#define TRIANGLE_CONTACT_MAX_POINTS 6     // cada aresta dos dois triângulos cruza o outro no máximo uma vez
+#define TRIANGLE_PARALLEL_EPSILON 1e-6f   // seno² abaixo do qual duas arestas são paralelas
+
+// Ponto de contato no mundo; normal aponta de B para A e depth é quanto A
+// precisa andar ao longo dela para separar
+struct ContactPoint {
+    glm::vec3 position;
+    glm::vec3 normal;
+    float depth;
+};
+
+// Contato reduzido entre dois corpos: até 4 pontos com a mesma normal
+struct ContactManifold {
+    glm::vec3 normal = glm::vec3(0.0f);
+    float depth = 0.0f;
+    ContactPoint points[MANIFOLD_MAX_POINTS];
+    int count = 0;
+
+    void reduce(const std::vector<ContactPoint>& candidates);
+};
+
+// Triângulos de B em SoA com o plano de cada um (dot(n, p) = d)
+struct alignas(32) TriangleBatch {
+    float ax[CONTACT_BATCH], ay[CONTACT_BATCH], az[CONTACT_BATCH];
+    float bx[CONTACT_BATCH], by[CONTACT_BATCH], bz[CONTACT_BATCH];
+    float cx[CONTACT_BATCH], cy[CONTACT_BATCH], cz[CONTACT_BATCH];
+    float nx[CONTACT_BATCH], ny[CONTACT_BATCH], nz[CONTACT_BATCH];
+    float d[CONTACT_BATCH];
+    int count = 0;
+
+    void set(int lane, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+    void triangle(int lane, glm::vec3* out) const;
+};
+
+void TriangleBatch::set(int lane, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    glm::vec3 n = glm::cross(b - a, c - a);
+    ax[lane] = a.x; ay[lane] = a.y; az[lane] = a.z;
+    bx[lane] = b.x; by[lane] = b.y; bz[lane] = b.z;
+    cx[lane] = c.x; cy[lane] = c.y; cz[lane] = c.z;
+    nx[lane] = n.x; ny[lane] = n.y; nz[lane] = n.z;
+    d[lane] = glm::dot(n, a);
+}
+
+void TriangleBatch::triangle(int lane, glm::vec3* out) const {
+    out[0] = glm::vec3(ax[lane], ay[lane], az[lane]);
+    out[1] = glm::vec3(bx[lane], by[lane], bz[lane]);
+    out[2] = glm::vec3(cx[lane], cy[lane], cz[lane]);
+}
+
+// Rejeição rápida de um triângulo de A contra o lote: as caixas precisam se
+// tocar e cada triângulo precisa cruzar (ou tocar) o plano do outro. O que
+// passa segue para o SAT exato de triangleContact.
+int triangleBatchMaskScalar(const TriangleBatch& batch, const glm::vec3* tri) {
+    glm::vec3 n = glm::cross(tri[1] - tri[0], tri[2] - tri[0]);
+    float d = glm::dot(n, tri[0]);
+    glm::vec3 lo = glm::min(tri[0], glm::min(tri[1], tri[2]));
+    glm::vec3 hi = glm::max(tri[0], glm::max(tri[1], tri[2]));
+
+    int mask = 0;
+    for (int i = 0; i < batch.count; i++) {
+        glm::vec3 b[3];
+        batch.triangle(i, b);
+        glm::vec3 bLo = glm::min(b[0], glm::min(b[1], b[2]));
+        glm::vec3 bHi = glm::max(b[0], glm::max(b[1], b[2]));
+        if (!checkAABBCollision(AABB{lo, hi}, AABB{bLo, bHi})) continue;
+
+        float s0 = glm::dot(n, b[0]) - d, s1 = glm::dot(n, b[1]) - d, s2 = glm::dot(n, b[2]) - d;
+        if (std::min({s0, s1, s2}) > 0.0f || std::max({s0, s1, s2}) < 0.0f) continue;
+
+        glm::vec3 bn(batch.nx[i], batch.ny[i], batch.nz[i]);
+        float t0 = glm::dot(bn, tri[0]) - batch.d[i], t1 = glm::dot(bn, tri[1]) - batch.d[i], t2 = glm::dot(bn, tri[2]) - batch.d[i];
+        if (std::min({t0, t1, t2}) > 0.0f || std::max({t0, t1, t2}) < 0.0f) continue;
+
+        mask |= 1 << i;
+    }
+    return mask;
+}
+
+#ifdef WIDE_BVH_X86
+// Quatro pistas a partir de lane
+int triangleBatchMaskSse(const TriangleBatch& batch, int lane, const glm::vec3* tri, const glm::vec3& n, float d, const glm::vec3& lo, const glm::vec3& hi) {
+    __m128 ax = _mm_load_ps(batch.ax + lane), ay = _mm_load_ps(batch.ay + lane), az = _mm_load_ps(batch.az + lane);
+    __m128 bx = _mm_load_ps(batch.bx + lane), by = _mm_load_ps(batch.by + lane), bz = _mm_load_ps(batch.bz + lane);
+    __m128 cx = _mm_load_ps(batch.cx + lane), cy = _mm_load_ps(batch.cy + lane), cz = _mm_load_ps(batch.cz + lane);
+
+    // caixas
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(_mm_min_ps(ax, _mm_min_ps(bx, cx)), _mm_set1_ps(hi.x)),
+                            _mm_cmpge_ps(_mm_max_ps(ax, _mm_max_ps(bx, cx)), _mm_set1_ps(lo.x)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_min_ps(ay, _mm_min_ps(by, cy)), _mm_set1_ps(hi.y)),
+                                     _mm_cmpge_ps(_mm_max_ps(ay, _mm_max_ps(by, cy)), _mm_set1_ps(lo.y))));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_min_ps(az, _mm_min_ps(bz, cz)), _mm_set1_ps(hi.z)),
+                                     _mm_cmpge_ps(_mm_max_ps(az, _mm_max_ps(bz, cz)), _mm_set1_ps(lo.z))));
+
+    // vértices de B contra o plano de A
+    __m128 nX = _mm_set1_ps(n.x), nY = _mm_set1_ps(n.y), nZ = _mm_set1_ps(n.z), dA = _mm_set1_ps(d);
+    __m128 sa = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nX, ax), _mm_mul_ps(nY, ay)), _mm_mul_ps(nZ, az)), dA);
+    __m128 sb = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nX, bx), _mm_mul_ps(nY, by)), _mm_mul_ps(nZ, bz)), dA);
+    __m128 sc = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nX, cx), _mm_mul_ps(nY, cy)), _mm_mul_ps(nZ, cz)), dA);
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_min_ps(sa, _mm_min_ps(sb, sc)), _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_max_ps(sa, _mm_max_ps(sb, sc)), _mm_setzero_ps()));
+
+    // vértices de A contra os planos de B
+    __m128 bnx = _mm_load_ps(batch.nx + lane), bny = _mm_load_ps(batch.ny + lane), bnz = _mm_load_ps(batch.nz + lane), dB = _mm_load_ps(batch.d + lane);
+    __m128 t[3];
+    for (int k = 0; k < 3; k++)
+        t[k] = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bnx, _mm_set1_ps(tri[k].x)), _mm_mul_ps(bny, _mm_set1_ps(tri[k].y))),
+                                     _mm_mul_ps(bnz, _mm_set1_ps(tri[k].z))), dB);
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_min_ps(t[0], _mm_min_ps(t[1], t[2])), _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_max_ps(t[0], _mm_max_ps(t[1], t[2])), _mm_setzero_ps()));
+
+    return _mm_movemask_ps(hit);
+}
+
+__attribute__((target("avx2,fma")))
+int triangleBatchMaskAvx2(const TriangleBatch& batch, const glm::vec3* tri, const glm::vec3& n, float d, const glm::vec3& lo, const glm::vec3& hi) {
+    __m256 ax = _mm256_load_ps(batch.ax), ay = _mm256_load_ps(batch.ay), az = _mm256_load_ps(batch.az);
+    __m256 bx = _mm256_load_ps(batch.bx), by = _mm256_load_ps(batch.by), bz = _mm256_load_ps(batch.bz);
+    __m256 cx = _mm256_load_ps(batch.cx), cy = _mm256_load_ps(batch.cy), cz = _mm256_load_ps(batch.cz);
+    const __m256 zero = _mm256_setzero_ps();
+
+    // caixas
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_min_ps(ax, _mm256_min_ps(bx, cx)), _mm256_set1_ps(hi.x), _CMP_LE_OQ),
+                               _mm256_cmp_ps(_mm256_max_ps(ax, _mm256_max_ps(bx, cx)), _mm256_set1_ps(lo.x), _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(_mm256_min_ps(ay, _mm256_min_ps(by, cy)), _mm256_set1_ps(hi.y), _CMP_LE_OQ),
+                                           _mm256_cmp_ps(_mm256_max_ps(ay, _mm256_max_ps(by, cy)), _mm256_set1_ps(lo.y), _CMP_GE_OQ)));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(_mm256_min_ps(az, _mm256_min_ps(bz, cz)), _mm256_set1_ps(hi.z), _CMP_LE_OQ),
+                                           _mm256_cmp_ps(_mm256_max_ps(az, _mm256_max_ps(bz, cz)), _mm256_set1_ps(lo.z), _CMP_GE_OQ)));
+
+    // vértices de B contra o plano de A
+    __m256 nX = _mm256_set1_ps(n.x), nY = _mm256_set1_ps(n.y), nZ = _mm256_set1_ps(n.z), dA = _mm256_set1_ps(d);
+    __m256 sa = _mm256_sub_ps(_mm256_fmadd_ps(nZ, az, _mm256_fmadd_ps(nY, ay, _mm256_mul_ps(nX, ax))), dA);
+    __m256 sb = _mm256_sub_ps(_mm256_fmadd_ps(nZ, bz, _mm256_fmadd_ps(nY, by, _mm256_mul_ps(nX, bx))), dA);
+    __m256 sc = _mm256_sub_ps(_mm256_fmadd_ps(nZ, cz, _mm256_fmadd_ps(nY, cy, _mm256_mul_ps(nX, cx))), dA);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_min_ps(sa, _mm256_min_ps(sb, sc)), zero, _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_max_ps(sa, _mm256_max_ps(sb, sc)), zero, _CMP_GE_OQ));
+
+    // vértices de A contra os planos de B
+    __m256 bnx = _mm256_load_ps(batch.nx), bny = _mm256_load_ps(batch.ny), bnz = _mm256_load_ps(batch.nz), dB = _mm256_load_ps(batch.d);
+    __m256 t[3];
+    for (int k = 0; k < 3; k++)
+        t[k] = _mm256_sub_ps(_mm256_fmadd_ps(bnz, _mm256_set1_ps(tri[k].z),
+                             _mm256_fmadd_ps(bny, _mm256_set1_ps(tri[k].y),
+                             _mm256_mul_ps(bnx, _mm256_set1_ps(tri[k].x)))), dB);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_min_ps(t[0], _mm256_min_ps(t[1], t[2])), zero, _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_max_ps(t[0], _mm256_max_ps(t[1], t[2])), zero, _CMP_GE_OQ));
+
+    return _mm256_movemask_ps(hit);
+}
+#endif
+
+// Despacho pelo nível detectado; pistas além de batch.count ficam fora da máscara
+int triangleBatchMask(const TriangleBatch& batch, const glm::vec3* tri) {
+#ifdef WIDE_BVH_X86
+    SimdLevel level = detectSimdLevel();
+    if (level != SIMD_SCALAR) {
+        glm::vec3 n = glm::cross(tri[1] - tri[0], tri[2] - tri[0]);
+        float d = glm::dot(n, tri[0]);
+        glm::vec3 lo = glm::min(tri[0], glm::min(tri[1], tri[2]));
+        glm::vec3 hi = glm::max(tri[0], glm::max(tri[1], tri[2]));
+        int valid = (1 << batch.count) - 1;
+
+        if (level == SIMD_AVX2)
+            return triangleBatchMaskAvx2(batch, tri, n, d, lo, hi) & valid;
+        int mask = triangleBatchMaskSse(batch, 0, tri, n, d, lo, hi);
+        if (batch.count > 4)
+            mask |= triangleBatchMaskSse(batch, 4, tri, n, d, lo, hi) << 4;
+        return mask & valid;
+    }
+#endif
+    return triangleBatchMaskScalar(batch, tri);
+}
+
+// SAT exato entre dois triângulos: 2 normais de face e 9 produtos de arestas.
+// Os eixos são orientados por preferred (de B para A) e o de menor
+// profundidade vira a normal. Os pontos são as travessias de cada aresta no
+// outro triângulo (o segmento de interseção); se eles só se tocam, fica o
+// ponto médio entre o vértice mais fundo de A e a face de B.
+int triangleContact(const glm::vec3* a, const glm::vec3* b, const glm::vec3& preferred, ContactPoint* out) {
+    glm::vec3 ea[3] = {a[1] - a[0], a[2] - a[1], a[0] - a[2]};
+    glm::vec3 eb[3] = {b[1] - b[0], b[2] - b[1], b[0] - b[2]};
+
+    glm::vec3 axes[11];
+    float scales[11];
+    axes[0] = glm::cross(ea[0], ea[1]);
+    scales[0] = glm::dot(ea[0], ea[0]) * glm::dot(ea[1], ea[1]);
+    axes[1] = glm::cross(eb[0], eb[1]);
+    scales[1] = glm::dot(eb[0], eb[0]) * glm::dot(eb[1], eb[1]);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            axes[2 + i * 3 + j] = glm::cross(ea[i], eb[j]);
+            scales[2 + i * 3 + j] = glm::dot(ea[i], ea[i]) * glm::dot(eb[j], eb[j]);
+        }
+    }
+
+    glm::vec3 normal(0.0f);
+    float depth = FLT_MAX;
+
+    for (int k = 0; k < 11; k++) {
+        float length2 = glm::dot(axes[k], axes[k]);
+        if (length2 <= TRIANGLE_PARALLEL_EPSILON * scales[k])
+            continue;
+
+        glm::vec3 axis = axes[k] / std::sqrt(length2);
+        if (glm::dot(axis, preferred) < 0.0f)
+            axis = -axis;
+
+        float a0 = glm::dot(axis, a[0]), a1 = glm::dot(axis, a[1]), a2 = glm::dot(axis, a[2]);
+        float b0 = glm::dot(axis, b[0]), b1 = glm::dot(axis, b[1]), b2 = glm::dot(axis, b[2]);
+        float aMin = std::min({a0, a1, a2}), aMax = std::max({a0, a1, a2});
+        float bMin = std::min({b0, b1, b2}), bMax = std::max({b0, b1, b2});
+
+        if (aMax < bMin || bMax < aMin)
+            return 0;
+
+        // quanto A anda em +axis até sair de B
+        float axisDepth = bMax - aMin;
+        if (axisDepth < depth) {
+            depth = axisDepth;
+            normal = axis;
+        }
+    }
+
+    if (depth == FLT_MAX)
+        return 0;
+
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        float t;
+        if (rayIntersectsTriangle(a[i], ea[i], b[0], b[1], b[2], t) && t <= 1.0f)
+            out[count++] = ContactPoint{a[i] + ea[i] * t, normal, depth};
+        if (rayIntersectsTriangle(b[i], eb[i], a[0], a[1], a[2], t) && t <= 1.0f)
+            out[count++] = ContactPoint{b[i] + eb[i] * t, normal, depth};
+    }
+
+    if (count == 0) {
+        glm::vec3 deepest = a[0];
+        for (int i = 1; i < 3; i++)
+            if (glm::dot(normal, a[i]) < glm::dot(normal, deepest))
+                deepest = a[i];
+        out[count++] = ContactPoint{deepest + normal * (depth * 0.5f), normal, depth};
+    }
+
+    return count;
+}
+
+// Normal média ponderada pela profundidade e até 4 pontos que cobrem a área
+// de contato: o mais fundo, o mais distante dele, o que maximiza o triângulo
+// e o que maximiza a área do lado oposto.
+void ContactManifold::reduce(const std::vector<ContactPoint>& candidates) {
+    count = 0;
+    depth = 0.0f;
+    if (candidates.empty()) return;
+
+    int deepest = 0;
+    glm::vec3 sum(0.0f);
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        sum += candidates[i].normal * candidates[i].depth;
+        if (candidates[i].depth > candidates[deepest].depth)
+            deepest = i;
+    }
+    depth = candidates[deepest].depth;
+    normal = glm::dot(sum, sum) > 0.0f ? glm::normalize(sum) : candidates[deepest].normal;
+
+    auto add = [&](int i) {
+        points[count] = candidates[i];
+        points[count].normal = normal;
+        count++;
+    };
+
+    add(deepest);
+    const glm::vec3 p0 = candidates[deepest].position;
+
+    int far = -1;
+    float farDistance = 0.0f;
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        glm::vec3 d = candidates[i].position - p0;
+        float distance = glm::dot(d, d);
+        if (distance > farDistance) {
+            farDistance = distance;
+            far = i;
+        }
+    }
+    if (far < 0) return;
+    add(far);
+    const glm::vec3 edge = candidates[far].position - p0;
+
+    // área com sinal no plano de contato
+    auto area = [&](const glm::vec3& p) {
+        return glm::dot(glm::cross(edge, p - p0), normal);
+    };
+
+    int third = -1;
+    float thirdArea = 0.0f;
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        float a = std::abs(area(candidates[i].position));
+        if (a > thirdArea) {
+            thirdArea = a;
+            third = i;
+        }
+    }
+    if (third < 0) return;
+    add(third);
+
+    float side = area(candidates[third].position) > 0.0f ? -1.0f : 1.0f;
+    int fourth = -1;
+    float fourthArea = 0.0f;
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        float a = area(candidates[i].position) * side;
+        if (a > fourthArea) {
+            fourthArea = a;
+            fourth = i;
+        }
+    }
+    if (fourth >= 0)
+        add(fourth);
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef CONVEX_H
+#define CONVEX_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "mesh.hpp"
+#include "profiler.hpp"
+
+#define HULL_DIRECTIONS 128          // direções da esfera de Fibonacci, além das 26 do k-DOP
+#define HULL_CACHE_MAGIC 0x4c4c5548  // "HULL"
+#define HULL_CACHE_VERSION 1
+
+// Proxy convexo de uma malha, no espaço do modelo: os vértices extremos da
+// malha numa amostra fixa de direções. É um subconjunto dos vértices do
+// fecho convexo (o proxy fica dentro do fecho exato, nunca fora) e basta
+// para GJK/EPA, que só pedem o ponto de suporte.
+struct ConvexHull {
+    std::vector<glm::vec3> points;  // vazio se a malha não tem vértices
+    AABB box = {glm::vec3(0.0f), glm::vec3(0.0f)};
+    uint64_t fingerprint = 0;  // da malha de origem, para validar o cache
+
+    glm::vec3 support(const glm::vec3& direction) const;
+    glm::vec3 center() const { return 0.5f * (box.min_corner + box.max_corner); }
+};
+
+glm::vec3 ConvexHull::support(const glm::vec3& direction) const {
+    int best = 0;
+    float bestDot = glm::dot(points[0], direction);
+    for (int i = 1; i < (int)points.size(); i++) {
+        float d = glm::dot(points[i], direction);
+        if (d > bestDot) {
+            bestDot = d;
+            best = i;
+        }
+    }
+    return points[best];
+}
+
+// 26 direções do k-DOP (faces, arestas e cantos de um cubo) pegam as
+// quinas dos móveis; a esfera de Fibonacci cobre o resto
+static const std::vector<glm::vec3>& hullDirections() {
+    static const std::vector<glm::vec3> directions = [] {
+        std::vector<glm::vec3> result;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                for (int z = -1; z <= 1; z++)
+                    if (x || y || z)
+                        result.push_back(glm::normalize(glm::vec3(x, y, z)));
+
+        float golden = glm::pi<float>() * (3.0f - std::sqrt(5.0f));
+        for (int i = 0; i < HULL_DIRECTIONS; i++) {
+            float y = 1.0f - 2.0f * (i + 0.5f) / HULL_DIRECTIONS;
+            float radius = std::sqrt(1.0f - y * y);
+            result.push_back(glm::vec3(std::cos(golden * i) * radius, y, std::sin(golden * i) * radius));
+        }
+        return result;
+    }();
+    return directions;
+}
+
+// FNV-1a das posições: muda se a malha mudar
+uint64_t meshFingerprint(const std::vector<Vertex>& vertices) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    uint64_t count = vertices.size();
+    mix(&count, sizeof(count));
+    for (const Vertex& vertex : vertices)
+        mix(&vertex.position, sizeof(vertex.position));
+    return hash;
+}
+
+ConvexHull buildConvexHull(const MeshData& mesh) {
+    ConvexHull hull;
+    hull.fingerprint = meshFingerprint(mesh.vertices);
+    if (mesh.vertices.empty()) return hull;
+
+    std::vector<unsigned char> taken(mesh.vertices.size(), 0);
+    for (const glm::vec3& direction : hullDirections()) {
+        size_t best = 0;
+        float bestDot = glm::dot(mesh.vertices[0].position, direction);
+        for (size_t i = 1; i < mesh.vertices.size(); i++) {
+            float d = glm::dot(mesh.vertices[i].position, direction);
+            if (d > bestDot) {
+                bestDot = d;
+                best = i;
+            }
+        }
+        if (taken[best]) continue;
+        taken[best] = 1;
+        hull.points.push_back(mesh.vertices[best].position);
+    }
+
+    hull.box = {hull.points[0], hull.points[0]};
+    for (const glm::vec3& p : hull.points) {
+        hull.box.min_corner = glm::min(hull.box.min_corner, p);
+        hull.box.max_corner = glm::max(hull.box.max_corner, p);
+    }
+    return hull;
+}
+
+// Cache binário ao lado do .obj; false se faltar, for de outra versão ou de
+// outra malha (as impressões digitais não batem)
+bool loadConvexHulls(const std::string& path, const std::vector<MeshData>& meshes, std::vector<ConvexHull>& hulls) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    uint32_t magic = 0, version = 0, count = 0;
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&count, sizeof(count));
+    if (!file || magic != HULL_CACHE_MAGIC || version != HULL_CACHE_VERSION || count != meshes.size())
+        return false;
+
+    hulls.assign(count, ConvexHull());
+    for (uint32_t i = 0; i < count; i++) {
+        ConvexHull& hull = hulls[i];
+        uint32_t points = 0;
+        file.read((char*)&hull.fingerprint, sizeof(hull.fingerprint));
+        file.read((char*)&points, sizeof(points));
+        if (!file || hull.fingerprint != meshFingerprint(meshes[i].vertices))
+            return false;
+
+        // um ponto por direção, no máximo um por vértice, vazio só sem vértices
+        const std::vector<Vertex>& vertices = meshes[i].vertices;
+        if (points > hullDirections().size() || points > vertices.size() || (points == 0) != vertices.empty())
+            return false;
+
+        hull.points.resize(points);
+        file.read((char*)hull.points.data(), points * sizeof(glm::vec3));
+        file.read((char*)&hull.box, sizeof(hull.box));
+    }
+    return (bool)file;
+}
+
+void saveConvexHulls(const std::string& path, const std::vector<ConvexHull>& hulls) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever cache de hulls: " << path << std::endl;
+        return;
+    }
+
+    uint32_t magic = HULL_CACHE_MAGIC, version = HULL_CACHE_VERSION, count = (uint32_t)hulls.size();
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&version, sizeof(version));
+    file.write((const char*)&count, sizeof(count));
+    for (const ConvexHull& hull : hulls) {
+        uint32_t points = (uint32_t)hull.points.size();
+        file.write((const char*)&hull.fingerprint, sizeof(hull.fingerprint));
+        file.write((const char*)&points, sizeof(points));
+        file.write((const char*)hull.points.data(), points * sizeof(glm::vec3));
+        file.write((const char*)&hull.box, sizeof(hull.box));
+    }
+}
+
+// Um hull por malha do .obj (grupo e material): uma decomposição aproximada
+// pelas partes que o próprio modelo já separa. data/<nome>/source/model.hulls
+std::vector<ConvexHull> loadOrBuildConvexHulls(const std::string& modelFile, const std::vector<MeshData>& meshes) {
+    PROFILE_FUNCTION();
+    std::string path = std::filesystem::path(modelFile).replace_extension(".hulls").string();
+
+    std::vector<ConvexHull> hulls;
+    if (loadConvexHulls(path, meshes, hulls))
+        return hulls;
+
+    hulls.clear();
+    for (const MeshData& mesh : meshes)
+        hulls.push_back(buildConvexHull(mesh));
+    saveConvexHulls(path, hulls);
+    return hulls;
+}
+
+#endif
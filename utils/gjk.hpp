@@ -0,0 +1,346 @@
+#ifndef GJK_H
+#define GJK_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+#include "convex.hpp"
+#include "contact.hpp"
+
+#define GJK_MAX_ITERATIONS 64
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_FACES 128
+#define EPA_MAX_EDGES 64
+#define EPA_TOLERANCE 1e-4f  // relativa ao tamanho da diferença de Minkowski
+#define HULL_FACE_TOLERANCE 0.02f  // espessura da face de contato, fração da diagonal do menor hull
+
+// Hull posicionado no mundo: a parte linear (rotação e escala) e a translação
+// da matriz do modelo. O suporte de M*p é M aplicado ao suporte local na
+// direção transposta, então os pontos do hull nunca são transformados todos.
+struct HullShape {
+    const ConvexHull* hull;
+    glm::mat3 linear;
+    glm::vec3 translation;
+
+    glm::vec3 support(const glm::vec3& direction) const {
+        return linear * hull->support(glm::transpose(linear) * direction) + translation;
+    }
+    glm::vec3 center() const { return linear * hull->center() + translation; }
+};
+
+// Ponto da diferença de Minkowski A - B, com o ponto de A que o gerou
+struct MinkowskiPoint {
+    glm::vec3 p;
+    glm::vec3 a;
+};
+
+static MinkowskiPoint minkowskiSupport(const HullShape& a, const HullShape& b, const glm::vec3& direction) {
+    glm::vec3 onA = a.support(direction);
+    return {onA - b.support(-direction), onA};
+}
+
+// Resultado de EPA: normal de B para A, profundidade e um ponto no meio da
+// sobreposição
+struct HullPenetration {
+    glm::vec3 normal;
+    float depth;
+    glm::vec3 point;
+};
+
+// Triângulo da origem e o caso de três pontos; d guarda o quarto quando o
+// simplex vira tetraedro
+static void gjkTriangle(MinkowskiPoint& a, MinkowskiPoint& b, MinkowskiPoint& c, MinkowskiPoint& d, int& dimension, glm::vec3& direction) {
+    glm::vec3 normal = glm::cross(b.p - a.p, c.p - a.p);
+    glm::vec3 ao = -a.p;
+
+    dimension = 2;
+    if (glm::dot(glm::cross(b.p - a.p, normal), ao) > 0.0f) {
+        c = a;
+        direction = glm::cross(glm::cross(b.p - a.p, ao), b.p - a.p);
+        return;
+    }
+    if (glm::dot(glm::cross(normal, c.p - a.p), ao) > 0.0f) {
+        b = a;
+        direction = glm::cross(glm::cross(c.p - a.p, ao), c.p - a.p);
+        return;
+    }
+
+    dimension = 3;
+    if (glm::dot(normal, ao) > 0.0f) {
+        d = c;
+        c = b;
+        b = a;
+        direction = normal;
+        return;
+    }
+    d = b;
+    b = a;
+    direction = -normal;
+}
+
+// true se a origem está dentro do tetraedro; senão troca pela face que a vê
+static bool gjkTetrahedron(MinkowskiPoint& a, MinkowskiPoint& b, MinkowskiPoint& c, MinkowskiPoint& d, int& dimension, glm::vec3& direction) {
+    glm::vec3 abc = glm::cross(b.p - a.p, c.p - a.p);
+    glm::vec3 acd = glm::cross(c.p - a.p, d.p - a.p);
+    glm::vec3 adb = glm::cross(d.p - a.p, b.p - a.p);
+    glm::vec3 ao = -a.p;
+
+    dimension = 3;
+    if (glm::dot(abc, ao) > 0.0f) {
+        d = c;
+        c = b;
+        b = a;
+        direction = abc;
+        return false;
+    }
+    if (glm::dot(acd, ao) > 0.0f) {
+        b = a;
+        direction = acd;
+        return false;
+    }
+    if (glm::dot(adb, ao) > 0.0f) {
+        c = d;
+        d = b;
+        b = a;
+        direction = adb;
+        return false;
+    }
+    return true;
+}
+
+struct EpaFace {
+    MinkowskiPoint v[3];
+    glm::vec3 normal;  // para fora do politopo
+};
+
+// Expande o tetraedro do GJK até achar a face da diferença mais próxima da
+// origem: a menor translação que separa os dois hulls
+static HullPenetration epa(const HullShape& shapeA, const HullShape& shapeB, const MinkowskiPoint& a, const MinkowskiPoint& b, const MinkowskiPoint& c, const MinkowskiPoint& d) {
+    EpaFace faces[EPA_MAX_FACES];
+    auto makeFace = [](const MinkowskiPoint& x, const MinkowskiPoint& y, const MinkowskiPoint& z) {
+        EpaFace face{{x, y, z}, glm::cross(y.p - x.p, z.p - x.p)};
+        float length = glm::length(face.normal);
+        face.normal = length > 0.0f ? face.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        return face;
+    };
+    faces[0] = makeFace(a, b, c);
+    faces[1] = makeFace(a, c, d);
+    faces[2] = makeFace(a, d, b);
+    faces[3] = makeFace(b, d, c);
+    int faceCount = 4;
+    for (int i = 0; i < faceCount; i++) {
+        if (glm::dot(faces[i].v[0].p, faces[i].normal) < 0.0f) {
+            std::swap(faces[i].v[0], faces[i].v[1]);
+            faces[i].normal = -faces[i].normal;
+        }
+    }
+
+    float scale = glm::max(glm::max(glm::length(a.p), glm::length(b.p)), glm::max(glm::length(c.p), glm::length(d.p)));
+    float tolerance = EPA_TOLERANCE * glm::max(scale, 1.0f);
+
+    auto findClosest = [&](float& minDistance) {
+        int closest = 0;
+        minDistance = glm::dot(faces[0].v[0].p, faces[0].normal);
+        for (int i = 1; i < faceCount; i++) {
+            float distance = glm::dot(faces[i].v[0].p, faces[i].normal);
+            if (distance < minDistance) {
+                minDistance = distance;
+                closest = i;
+            }
+        }
+        return closest;
+    };
+
+    EpaFace best = faces[0];  // mais próxima da última iteração completa
+    for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+        float minDistance;
+        best = faces[findClosest(minDistance)];
+
+        glm::vec3 direction = best.normal;
+        MinkowskiPoint p = minkowskiSupport(shapeA, shapeB, direction);
+        if (glm::dot(p.p, direction) - minDistance < tolerance)
+            break;
+
+        // as faces que veem p saem; as arestas que sobram formam o horizonte.
+        // Nada muda antes de saber que o horizonte cabe nos arrays.
+        bool visible[EPA_MAX_FACES];
+        MinkowskiPoint edges[EPA_MAX_EDGES][2];
+        int edgeCount = 0, removed = 0;
+        bool full = false;
+        for (int i = 0; i < faceCount && !full; i++) {
+            visible[i] = glm::dot(faces[i].normal, p.p - faces[i].v[0].p) > 0.0f;
+            if (!visible[i]) continue;
+            removed++;
+
+            for (int j = 0; j < 3; j++) {
+                const MinkowskiPoint& e0 = faces[i].v[j];
+                const MinkowskiPoint& e1 = faces[i].v[(j + 1) % 3];
+                bool shared = false;
+                for (int k = 0; k < edgeCount; k++) {
+                    if (edges[k][1].p == e0.p && edges[k][0].p == e1.p) {
+                        edges[k][0] = edges[edgeCount - 1][0];
+                        edges[k][1] = edges[edgeCount - 1][1];
+                        edgeCount--;
+                        shared = true;
+                        break;
+                    }
+                }
+                if (shared) continue;
+                if (edgeCount == EPA_MAX_EDGES) {
+                    full = true;
+                    break;
+                }
+                edges[edgeCount][0] = e0;
+                edges[edgeCount][1] = e1;
+                edgeCount++;
+            }
+        }
+        // sem espaço para o politopo novo: fica com a última face válida
+        if (full || faceCount - removed + edgeCount > EPA_MAX_FACES)
+            break;
+
+        int kept = 0;
+        for (int i = 0; i < faceCount; i++)
+            if (!visible[i])
+                faces[kept++] = faces[i];
+        faceCount = kept;
+
+        for (int k = 0; k < edgeCount; k++) {
+            EpaFace face = makeFace(edges[k][0], edges[k][1], p);
+            // mantém a normal para fora
+            if (glm::dot(face.v[0].p, face.normal) < -1e-6f) {
+                std::swap(face.v[0], face.v[1]);
+                face.normal = -face.normal;
+            }
+            faces[faceCount++] = face;
+        }
+        if (faceCount == 0) break;
+    }
+
+    // a compactação mexe nos índices: a mais próxima é procurada de novo no
+    // politopo final (igual a best quando o laço parou antes de expandir)
+    if (faceCount > 0) {
+        float minDistance;
+        best = faces[findClosest(minDistance)];
+    }
+
+    // projeção da origem na face, em baricêntricas, leva ao ponto de A
+    const EpaFace& face = best;
+    float distance = glm::dot(face.v[0].p, face.normal);
+    glm::vec3 projected = face.normal * distance;
+    glm::vec3 v0 = face.v[1].p - face.v[0].p, v1 = face.v[2].p - face.v[0].p, v2 = projected - face.v[0].p;
+    float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+    float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+    float denominator = d00 * d11 - d01 * d01;
+    float u = 1.0f / 3.0f, v = 1.0f / 3.0f;
+    if (std::abs(denominator) > 1e-12f) {
+        u = (d11 * d20 - d01 * d21) / denominator;
+        v = (d00 * d21 - d01 * d20) / denominator;
+    }
+    glm::vec3 onA = face.v[0].a * (1.0f - u - v) + face.v[1].a * u + face.v[2].a * v;
+
+    HullPenetration result;
+    result.normal = -face.normal;
+    result.depth = glm::max(distance, 0.0f);
+    result.point = onA - face.normal * (0.5f * result.depth);
+    return result;
+}
+
+// GJK: a origem está na diferença A - B? Com penetration, EPA diz quanto.
+bool gjkIntersect(const HullShape& shapeA, const HullShape& shapeB, HullPenetration* penetration = nullptr) {
+    MinkowskiPoint a, b, c, d;
+    glm::vec3 direction = shapeA.center() - shapeB.center();
+    if (glm::dot(direction, direction) < 1e-12f)
+        direction = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    c = minkowskiSupport(shapeA, shapeB, direction);
+    direction = -c.p;
+    b = minkowskiSupport(shapeA, shapeB, direction);
+    if (glm::dot(b.p, direction) < 0.0f) return false;
+
+    direction = glm::cross(glm::cross(c.p - b.p, -b.p), c.p - b.p);
+    if (glm::dot(direction, direction) < 1e-12f) {
+        direction = glm::cross(c.p - b.p, glm::vec3(1.0f, 0.0f, 0.0f));
+        if (glm::dot(direction, direction) < 1e-12f)
+            direction = glm::cross(c.p - b.p, glm::vec3(0.0f, 0.0f, -1.0f));
+    }
+
+    int dimension = 2;
+    for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++) {
+        a = minkowskiSupport(shapeA, shapeB, direction);
+        if (glm::dot(a.p, direction) < 0.0f) return false;
+
+        dimension++;
+        if (dimension == 3) {
+            gjkTriangle(a, b, c, d, dimension, direction);
+        } else if (gjkTetrahedron(a, b, c, d, dimension, direction)) {
+            if (penetration)
+                *penetration = epa(shapeA, shapeB, a, b, c, d);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pontos do manifold de um par que penetra: o ponto de EPA e os vértices das
+// duas faces de contato (os pontos de cada hull a até tolerance do plano de
+// contato) que caem dentro da sobreposição das faces no plano tangente. Uma
+// face apoiada em outra dá os seus cantos, e o solver tem braço para o torque.
+void hullFaceContacts(const HullShape& shapeA, const HullShape& shapeB, const HullPenetration& penetration, std::vector<ContactPoint>& contacts) {
+    const glm::vec3 normal = penetration.normal;
+    contacts.push_back({penetration.point, normal, penetration.depth});
+
+    glm::vec3 axis = glm::abs(normal.x) < 0.57f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 tangent[2];
+    tangent[0] = glm::normalize(glm::cross(normal, axis));
+    tangent[1] = glm::cross(normal, tangent[0]);
+
+    auto worldPoints = [](const HullShape& shape) {
+        std::vector<glm::vec3> points;
+        points.reserve(shape.hull->points.size());
+        for (const glm::vec3& p : shape.hull->points)
+            points.push_back(shape.linear * p + shape.translation);
+        return points;
+    };
+    std::vector<glm::vec3> pointsA = worldPoints(shapeA);
+    std::vector<glm::vec3> pointsB = worldPoints(shapeB);
+
+    glm::vec3 sizeA = shapeA.linear * (shapeA.hull->box.max_corner - shapeA.hull->box.min_corner);
+    glm::vec3 sizeB = shapeB.linear * (shapeB.hull->box.max_corner - shapeB.hull->box.min_corner);
+    float tolerance = penetration.depth + HULL_FACE_TOLERANCE * glm::min(glm::length(sizeA), glm::length(sizeB));
+
+    // A encosta em B pelo lado de -normal, B em A pelo lado de +normal
+    float aLow = FLT_MAX, bHigh = -FLT_MAX;
+    for (const glm::vec3& p : pointsA) aLow = glm::min(aLow, glm::dot(p, normal));
+    for (const glm::vec3& p : pointsB) bHigh = glm::max(bHigh, glm::dot(p, normal));
+
+    std::vector<glm::vec3> face;
+    glm::vec2 aMin(FLT_MAX), aMax(-FLT_MAX), bMin(FLT_MAX), bMax(-FLT_MAX);
+    for (const glm::vec3& p : pointsA) {
+        if (glm::dot(p, normal) > aLow + tolerance) continue;
+        glm::vec2 t(glm::dot(p, tangent[0]), glm::dot(p, tangent[1]));
+        aMin = glm::min(aMin, t);
+        aMax = glm::max(aMax, t);
+        face.push_back(p);
+    }
+    for (const glm::vec3& p : pointsB) {
+        if (glm::dot(p, normal) < bHigh - tolerance) continue;
+        glm::vec2 t(glm::dot(p, tangent[0]), glm::dot(p, tangent[1]));
+        bMin = glm::min(bMin, t);
+        bMax = glm::max(bMax, t);
+        face.push_back(p);
+    }
+
+    glm::vec2 low = glm::max(aMin, bMin), high = glm::min(aMax, bMax);
+    if (low.x > high.x || low.y > high.y) return;
+
+    float middle = 0.5f * (aLow + bHigh);
+    for (const glm::vec3& p : face) {
+        glm::vec2 t(glm::dot(p, tangent[0]), glm::dot(p, tangent[1]));
+        if (t.x < low.x || t.x > high.x || t.y < low.y || t.y > high.y) continue;
+        contacts.push_back({p + normal * (middle - glm::dot(p, normal)), normal, penetration.depth});
+    }
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <GL/glew.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdio>
+
+// quantos frames de consultas ficam em voo antes de ler os resultados
+#define GPU_PROFILER_LATENCY 4
+#define GPU_PROFILER_HISTORY 2000
+
+struct GpuZoneResult {
+    std::string name;
+    int depth;
+    double startMs;     // relativo ao início do frame na GPU
+    double durationMs;
+    double traceUs;     // no relógio da CPU, para o Chrome trace
+};
+
+struct GpuFrameResult {
+    long frame = -1;
+    std::vector<GpuZoneResult> zones;
+};
+
+// Mede passes de renderização com timer queries em um anel de frames.
+// Cada zona usa um par de GL_TIMESTAMP (glQueryCounter): ao contrário de
+// GL_TIME_ELAPSED, timestamps podem ser aninhados (passe > draw de um modelo)
+// e dão o instante de início necessário para o trace.
+struct GpuProfiler {
+    bool enabled = true;
+    bool perDraw = false;
+
+    GpuFrameResult latest;
+    std::deque<GpuFrameResult> history;
+    long droppedFrames = 0;
+
+    // instante da CPU correspondente a traceUs = 0
+    std::chrono::steady_clock::time_point cpuEpoch;
+
+    void init();
+    void beginFrame(long frame);
+    int begin(const char* name);
+    void end(int zone);
+    void flush();
+    void destroy();
+
+    void printTable() const;
+    bool writeCsv(const std::string& path) const;
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    struct Zone {
+        const char* name;
+        int depth;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    struct FrameSlot {
+        long frame = -1;
+        std::vector<Zone> zones;
+        std::vector<GLuint> pool;
+        size_t used = 0;
+    };
+
+    FrameSlot slots[GPU_PROFILER_LATENCY];
+    FrameSlot* current = nullptr;
+    int depth = 0;
+
+    // alinhamento entre o relógio da GPU e o da CPU
+    GLint64 gpuEpochNs = 0;
+
+    GLuint acquireQuery();
+    void collect(FrameSlot& slot);
+};
+
+void GpuProfiler::init() {
+    glGetInteger64v(GL_TIMESTAMP, &gpuEpochNs);
+    cpuEpoch = std::chrono::steady_clock::now();
+}
+
+GLuint GpuProfiler::acquireQuery() {
+    if (current->used == current->pool.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        current->pool.push_back(query);
+    }
+    return current->pool[current->used++];
+}
+
+void GpuProfiler::beginFrame(long frame) {
+    if (!enabled) {
+        current = nullptr;
+        return;
+    }
+
+    // o slot reaproveitado contém o frame de GPU_PROFILER_LATENCY frames atrás
+    current = &slots[frame % GPU_PROFILER_LATENCY];
+    if (current->frame >= 0)
+        collect(*current);
+
+    current->frame = frame;
+    current->zones.clear();
+    current->used = 0;
+    depth = 0;
+}
+
+int GpuProfiler::begin(const char* name) {
+    if (!current) return -1;
+
+    Zone zone;
+    zone.name = name;
+    zone.depth = depth++;
+    zone.beginQuery = acquireQuery();
+    zone.endQuery = acquireQuery();
+    glQueryCounter(zone.beginQuery, GL_TIMESTAMP);
+
+    current->zones.push_back(zone);
+    return (int)current->zones.size() - 1;
+}
+
+void GpuProfiler::end(int zone) {
+    if (!current || zone < 0) return;
+    glQueryCounter(current->zones[zone].endQuery, GL_TIMESTAMP);
+    depth--;
+}
+
+// Lê os resultados sem bloquear: se a GPU ainda não terminou, o frame é descartado
+void GpuProfiler::collect(FrameSlot& slot) {
+    if (slot.zones.empty()) return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(slot.zones.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        droppedFrames++;
+        slot.frame = -1;
+        return;
+    }
+
+    GpuFrameResult result;
+    result.frame = slot.frame;
+
+    GLuint64 frameStart = 0;
+    double cpuOffsetUs = 0.0;
+    for (size_t i = 0; i < slot.zones.size(); i++) {
+        GLuint64 beginNs = 0, endNs = 0;
+        glGetQueryObjectui64v(slot.zones[i].beginQuery, GL_QUERY_RESULT, &beginNs);
+        glGetQueryObjectui64v(slot.zones[i].endQuery, GL_QUERY_RESULT, &endNs);
+
+        if (i == 0) {
+            frameStart = beginNs;
+            cpuOffsetUs = (double)((GLint64)beginNs - gpuEpochNs) / 1000.0;
+        }
+
+        GpuZoneResult zone;
+        zone.name = slot.zones[i].name;
+        zone.depth = slot.zones[i].depth;
+        zone.startMs = (double)(beginNs - frameStart) / 1.0e6;
+        zone.durationMs = (double)(endNs - beginNs) / 1.0e6;
+        zone.traceUs = cpuOffsetUs + zone.startMs * 1000.0;
+        result.zones.push_back(zone);
+    }
+
+    latest = result;
+    history.push_back(result);
+    if (history.size() > GPU_PROFILER_HISTORY)
+        history.pop_front();
+
+    slot.frame = -1;
+}
+
+// Fim da execução: espera a GPU e coleta os frames ainda em voo, em ordem
+void GpuProfiler::flush() {
+    glFinish();
+
+    for (int i = 0; i < GPU_PROFILER_LATENCY; i++) {
+        FrameSlot* oldest = nullptr;
+        for (FrameSlot& slot : slots)
+            if (slot.frame >= 0 && (!oldest || slot.frame < oldest->frame))
+                oldest = &slot;
+
+        if (!oldest) break;
+        collect(*oldest);
+    }
+    current = nullptr;
+}
+
+void GpuProfiler::printTable() const {
+    if (latest.frame < 0) {
+        std::cout << "GPU: nenhum frame coletado ainda" << std::endl;
+        return;
+    }
+
+    std::ostringstream table;
+    table << "GPU frame " << latest.frame << " (descartados: " << droppedFrames << ")\n";
+    for (const GpuZoneResult& zone : latest.zones) {
+        table << "  " << std::string(zone.depth * 2, ' ')
+              << std::left << std::setw(24 - zone.depth * 2) << zone.name
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(9) << zone.durationMs << " ms\n";
+    }
+    std::cout << table.str() << std::flush;
+}
+
+// String JSON entre aspas; nomes de zona vêm de Model::name e podem ter de tudo
+static void writeTraceString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Campo CSV entre aspas, com as aspas internas dobradas (RFC 4180)
+static void writeCsvField(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"') out << '"';
+        out << c;
+    }
+    out << '"';
+}
+
+bool GpuProfiler::writeCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever CSV: " << path << std::endl;
+        return false;
+    }
+
+    file << "frame,zone,depth,start_ms,duration_ms\n";
+    for (const GpuFrameResult& frame : history) {
+        for (const GpuZoneResult& zone : frame.zones) {
+            file << frame.frame << ",";
+            writeCsvField(file, zone.name);
+            file << "," << zone.depth << "," << zone.startMs << "," << zone.durationMs << "\n";
+        }
+    }
+    return true;
+}
+
+bool GpuProfiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever trace: " << path << std::endl;
+        return false;
+    }
+
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}";
+    for (const GpuFrameResult& frame : history) {
+        for (const GpuZoneResult& zone : frame.zones) {
+            file << ",\n{\"name\": ";
+            writeTraceString(file, zone.name);
+            file << ", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0"
+                 << ", \"ts\": " << std::fixed << std::setprecision(3) << zone.traceUs
+                 << ", \"dur\": " << zone.durationMs * 1000.0
+                 << ", \"args\": {\"frame\": " << frame.frame << "}}";
+        }
+    }
+    file << "\n]}\n";
+    return true;
+}
+
+void GpuProfiler::destroy() {
+    for (FrameSlot& slot : slots) {
+        if (!slot.pool.empty())
+            glDeleteQueries((GLsizei)slot.pool.size(), slot.pool.data());
+        slot.pool.clear();
+    }
+}
+
+// Zona RAII: GpuScope scope(profiler, "scene");
+struct GpuScope {
+    GpuProfiler& profiler;
+    int zone;
+
+    GpuScope(GpuProfiler& p, const char* name, bool active = true): profiler(p), zone(active ? p.begin(name) : -1) {}
+    ~GpuScope() { profiler.end(zone); }
+};
+
+#endif
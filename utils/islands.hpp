@@ -0,0 +1,110 @@
+#ifndef ISLANDS_H
+#define ISLANDS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cmath>
+#include "rigid_body.hpp"
+
+#define SLEEP_ENERGY 0.05f              // energia cinética por unidade de massa abaixo da qual o corpo está quieto
+#define SLEEP_TIME 0.5f                 // segundos quieta antes de a ilha dormir
+#define SLEEP_WAKE_ACCELERATION 0.5f    // aceleração do tremor que acorda todos os corpos
+#define SLEEP_WAKE_SPIN 0.01f           // giro do tremor (graus por frame de 60 Hz) que acorda todos
+
+// Ilhas de corpos ligados por contatos, refeitas a cada passo por union-find.
+// Uma ilha só dorme inteira: quando todos os seus corpos ficaram quietos por
+// SLEEP_TIME. Um contato com um corpo acordado acorda o corpo dormindo
+// (ContactSolver), e no passo seguinte ele volta à ilha do outro.
+// A energia vem do deslocamento e da rotação no passo, não das velocidades
+// guardadas: um corpo apoiado no chão ganha da gravidade e perde no quique a
+// cada passo sem sair do lugar, e só o giro em Y local muda a orientação.
+struct IslandSleep {
+    bool enabled = true;
+
+    void begin(int count);
+    void unite(int a, int b);
+    void update(RigidBodyWorld& world, float dt);
+    void wakeAll(RigidBodyWorld& world);
+
+private:
+    std::vector<int> parent;
+    std::vector<float> quietTime;   // por corpo
+    std::vector<glm::vec3> lastPosition;
+    std::vector<glm::quat> lastOrientation;
+    std::vector<float> islandQuiet; // menor quietTime da ilha, indexado pela raiz
+    std::vector<unsigned char> islandAwake;
+
+    int find(int i);
+};
+
+// Cada corpo começa na própria ilha
+void IslandSleep::begin(int count) {
+    parent.resize(count);
+    for (int i = 0; i < count; i++)
+        parent[i] = i;
+    quietTime.resize(count, 0.0f);
+    lastPosition.resize(count, glm::vec3(0.0f));
+    lastOrientation.resize(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+}
+
+// Com compressão de caminho pela metade
+int IslandSleep::find(int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void IslandSleep::unite(int a, int b) {
+    a = find(a);
+    b = find(b);
+    if (a != b)
+        parent[a < b ? b : a] = a < b ? a : b;
+}
+
+// Depois da resolução dos contatos: mede a energia dos corpos acordados e
+// põe para dormir as ilhas que ficaram quietas tempo suficiente
+void IslandSleep::update(RigidBodyWorld& world, float dt) {
+    if (!enabled) return;
+    int count = world.size();
+
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position = world.position(i);
+        glm::quat orientation = world.orientation(i);
+        glm::vec3 v = (position - lastPosition[i]) / dt;
+        float cosHalf = glm::min(glm::abs(glm::dot(orientation, lastOrientation[i])), 1.0f);
+        float w = 2.0f * std::acos(cosHalf) / dt;
+        lastPosition[i] = position;
+        lastOrientation[i] = orientation;
+        if (world.sleeping(i)) continue;
+
+        float energy = 0.5f * (glm::dot(v, v) + w * w);
+        quietTime[i] = energy < SLEEP_ENERGY ? quietTime[i] + dt : 0.0f;
+    }
+
+    islandQuiet.assign(count, SLEEP_TIME);
+    islandAwake.assign(count, 0);
+    for (int i = 0; i < count; i++) {
+        int root = find(i);
+        islandQuiet[root] = glm::min(islandQuiet[root], quietTime[i]);
+        islandAwake[root] |= !world.sleeping(i);
+    }
+
+    for (int i = 0; i < count; i++) {
+        int root = find(i);
+        if (islandAwake[root] && islandQuiet[root] >= SLEEP_TIME && !world.sleeping(i))
+            world.sleep(i);
+    }
+}
+
+// Tremor acima do limite: tudo volta a integrar e a contagem recomeça
+void IslandSleep::wakeAll(RigidBodyWorld& world) {
+    for (int i = 0; i < world.size(); i++)
+        world.wake(i);
+    quietTime.assign(world.size(), 0.0f);
+}
+
+#endif
@@ -0,0 +1,374 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "shaders.hpp"
+#include "profiler.hpp"
+
+// Grade de clusters no espaço de visão: tiles em tela (X, Y) e fatias
+// exponenciais de profundidade (Z)
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS_PER_CLUSTER 64
+#define CLUSTER_PARALLEL_THRESHOLD 32
+
+// unidades de textura reservadas para os buffers de luz (0-2 são do material)
+#define CLUSTER_LIGHTS_UNIT 5
+#define CLUSTER_GRID_UNIT 6
+#define CLUSTER_INDICES_UNIT 7
+
+struct PointLight {
+    glm::vec3 position;
+    float radius = 40.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+};
+
+struct ClusterBounds {
+    glm::vec3 min_corner;
+    glm::vec3 max_corner;
+};
+
+// Mantém a grade de clusters na CPU e os texture buffers usados pelo fragment shader
+struct LightClusterGrid {
+    std::vector<PointLight> lights;
+
+    float zNear = 0.1f;
+    float zFar = 1000.0f;
+    glm::vec2 screenSize = glm::vec2(0.0f);
+    glm::mat4 projection = glm::mat4(0.0f);
+
+    std::vector<ClusterBounds> clusterBounds;   // AABB de cada cluster (espaço de visão)
+    std::vector<GLuint> clusterData;            // (offset, count) por cluster
+    std::vector<GLuint> lightIndices;           // listas compactadas
+    std::vector<glm::vec4> lightData;           // 2 texels por luz
+    int droppedLights = 0;                      // luzes cortadas de clusters cheios no último update
+
+    GLuint lightsBuffer = 0, lightsTexture = 0;
+    GLuint gridBuffer = 0, gridTexture = 0;
+    GLuint indicesBuffer = 0, indicesTexture = 0;
+
+    void init();
+    void update(const glm::mat4& view, const glm::mat4& proj, float near, float far);
+    void bind(const Shader& s) const;
+    void destroy();
+
+    int sliceForDepth(float depth) const;
+
+private:
+    void buildClusterBounds();
+    int assignSlices(int zBegin, int zEnd,
+                      const std::vector<glm::vec4>& viewLights,
+                      const std::vector<std::vector<int>>& lightsBySlice,
+                      const std::vector<glm::ivec4>& tileRanges,
+                      std::vector<std::vector<GLuint>>& clusterLists) const;
+    glm::ivec4 tileRange(const glm::vec3& center, float radius) const;
+    float lightWeight(int lightIdx, const glm::vec4& viewLight, const ClusterBounds& b) const;
+    void upload(GLuint buffer, const void* data, size_t size);
+};
+
+void LightClusterGrid::init() {
+    GLuint buffers[3];
+    GLuint textures[3];
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+
+    lightsBuffer = buffers[0];
+    gridBuffer = buffers[1];
+    indicesBuffer = buffers[2];
+    lightsTexture = textures[0];
+    gridTexture = textures[1];
+    indicesTexture = textures[2];
+
+    clusterData.assign(CLUSTER_COUNT * 2, 0);
+}
+
+int LightClusterGrid::sliceForDepth(float depth) const {
+    // fatias exponenciais: z_k = near * (far / near)^(k / Z)
+    if (depth <= zNear) return 0;
+    int slice = (int)std::floor(std::log(depth / zNear) * CLUSTER_Z / std::log(zFar / zNear));
+    return glm::clamp(slice, 0, CLUSTER_Z - 1);
+}
+
+void LightClusterGrid::buildClusterBounds() {
+    clusterBounds.resize(CLUSTER_COUNT);
+    glm::mat4 invProjection = glm::inverse(projection);
+
+    // ponto da tela (NDC) projetado no plano z = -1 do espaço de visão
+    auto screenToView = [&](glm::vec2 ndc) {
+        glm::vec4 v = invProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+        v /= v.w;
+        return glm::vec3(v) / -v.z;
+    };
+
+    for (int z = 0; z < CLUSTER_Z; z++) {
+        float sliceNear = zNear * std::pow(zFar / zNear, (float)z / CLUSTER_Z);
+        float sliceFar = zNear * std::pow(zFar / zNear, (float)(z + 1) / CLUSTER_Z);
+
+        for (int y = 0; y < CLUSTER_Y; y++) {
+            for (int x = 0; x < CLUSTER_X; x++) {
+                glm::vec2 ndcMin(2.0f * x / CLUSTER_X - 1.0f, 2.0f * y / CLUSTER_Y - 1.0f);
+                glm::vec2 ndcMax(2.0f * (x + 1) / CLUSTER_X - 1.0f, 2.0f * (y + 1) / CLUSTER_Y - 1.0f);
+
+                glm::vec3 rayMin = screenToView(ndcMin);
+                glm::vec3 rayMax = screenToView(ndcMax);
+
+                glm::vec3 points[4] = {
+                    rayMin * sliceNear, rayMax * sliceNear,
+                    rayMin * sliceFar, rayMax * sliceFar
+                };
+
+                ClusterBounds& b = clusterBounds[(z * CLUSTER_Y + y) * CLUSTER_X + x];
+                b.min_corner = points[0];
+                b.max_corner = points[0];
+                for (const glm::vec3& p : points) {
+                    b.min_corner = glm::min(b.min_corner, p);
+                    b.max_corner = glm::max(b.max_corner, p);
+                }
+            }
+        }
+    }
+}
+
+// Intervalo conservador de tiles (x0, y0, x1, y1) cobertos pela esfera da luz
+glm::ivec4 LightClusterGrid::tileRange(const glm::vec3& center, float radius) const {
+    glm::ivec4 full(0, 0, CLUSTER_X - 1, CLUSTER_Y - 1);
+
+    // esfera cruza o plano near: qualquer tile pode ser afetado
+    if (center.z + radius > -zNear) return full;
+
+    glm::vec2 ndcMin(FLT_MAX);
+    glm::vec2 ndcMax(-FLT_MAX);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = center + glm::vec3(
+            (i & 1) ? radius : -radius,
+            (i & 2) ? radius : -radius,
+            (i & 4) ? radius : -radius
+        );
+        glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+        glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+        ndcMin = glm::vec2(std::min(ndcMin.x, ndc.x), std::min(ndcMin.y, ndc.y));
+        ndcMax = glm::vec2(std::max(ndcMax.x, ndc.x), std::max(ndcMax.y, ndc.y));
+    }
+
+    if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+        return glm::ivec4(0, 0, -1, -1);
+
+    glm::ivec4 range(
+        (int)std::floor((ndcMin.x * 0.5f + 0.5f) * CLUSTER_X),
+        (int)std::floor((ndcMin.y * 0.5f + 0.5f) * CLUSTER_Y),
+        (int)std::floor((ndcMax.x * 0.5f + 0.5f) * CLUSTER_X),
+        (int)std::floor((ndcMax.y * 0.5f + 0.5f) * CLUSTER_Y)
+    );
+
+    range.x = glm::clamp(range.x, 0, CLUSTER_X - 1);
+    range.y = glm::clamp(range.y, 0, CLUSTER_Y - 1);
+    range.z = glm::clamp(range.z, 0, CLUSTER_X - 1);
+    range.w = glm::clamp(range.w, 0, CLUSTER_Y - 1);
+    return range;
+}
+
+// Atenuação do fragment shader no ponto do cluster mais perto da luz, vezes
+// a intensidade e o canal mais forte da cor
+float LightClusterGrid::lightWeight(int lightIdx, const glm::vec4& viewLight, const ClusterBounds& b) const {
+    glm::vec3 center = glm::vec3(viewLight);
+    float dist = glm::length(glm::clamp(center, b.min_corner, b.max_corner) - center);
+    float falloff = glm::clamp(1.0f - std::pow(dist / viewLight.w, 4.0f), 0.0f, 1.0f);
+    const PointLight& light = lights[lightIdx];
+    return falloff * falloff * light.intensity * std::max(light.color.r, std::max(light.color.g, light.color.b));
+}
+
+// Cada thread é dona de um intervalo de fatias Z, então nenhuma lista é compartilhada.
+// Cluster com mais de MAX_LIGHTS_PER_CLUSTER luzes fica com as que mais
+// iluminam, não com as de menor índice; devolve quantas foram cortadas.
+int LightClusterGrid::assignSlices(
+    int zBegin, int zEnd,
+    const std::vector<glm::vec4>& viewLights,
+    const std::vector<std::vector<int>>& lightsBySlice,
+    const std::vector<glm::ivec4>& tileRanges,
+    std::vector<std::vector<GLuint>>& clusterLists
+) const {
+    PROFILE_FUNCTION();
+    for (int z = zBegin; z < zEnd; z++) {
+        for (int lightIdx : lightsBySlice[z]) {
+            glm::vec3 center = glm::vec3(viewLights[lightIdx]);
+            float radius = viewLights[lightIdx].w;
+            const glm::ivec4& range = tileRanges[lightIdx];
+
+            for (int y = range.y; y <= range.w; y++) {
+                for (int x = range.x; x <= range.z; x++) {
+                    int cluster = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+                    const ClusterBounds& b = clusterBounds[cluster];
+
+                    // esfera x AABB: distância ao ponto mais próximo da caixa
+                    glm::vec3 closest = glm::clamp(center, b.min_corner, b.max_corner);
+                    glm::vec3 d = closest - center;
+                    if (glm::dot(d, d) > radius * radius) continue;
+
+                    clusterLists[cluster].push_back(lightIdx);
+                }
+            }
+        }
+    }
+
+    int dropped = 0;
+    std::vector<std::pair<float, GLuint>> ranked;
+    for (int cluster = zBegin * CLUSTER_X * CLUSTER_Y; cluster < zEnd * CLUSTER_X * CLUSTER_Y; cluster++) {
+        std::vector<GLuint>& list = clusterLists[cluster];
+        if (list.size() <= MAX_LIGHTS_PER_CLUSTER) continue;
+        dropped += (int)list.size() - MAX_LIGHTS_PER_CLUSTER;
+
+        ranked.clear();
+        for (GLuint lightIdx : list)
+            ranked.push_back({lightWeight(lightIdx, viewLights[lightIdx], clusterBounds[cluster]), lightIdx});
+        // empate pelo índice: o corte não muda de um frame para o outro à toa
+        std::partial_sort(ranked.begin(), ranked.begin() + MAX_LIGHTS_PER_CLUSTER, ranked.end(),
+            [](const std::pair<float, GLuint>& a, const std::pair<float, GLuint>& b) {
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            });
+
+        list.resize(MAX_LIGHTS_PER_CLUSTER);
+        for (int i = 0; i < MAX_LIGHTS_PER_CLUSTER; i++)
+            list[i] = ranked[i].second;
+        std::sort(list.begin(), list.end());
+    }
+    return dropped;
+}
+
+void LightClusterGrid::update(const glm::mat4& view, const glm::mat4& proj, float near, float far) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glm::vec2 currentScreen((float)viewport[2], (float)viewport[3]);
+
+    bool projectionChanged = clusterBounds.empty() || near != zNear || far != zFar ||
+        currentScreen != screenSize;
+    for (int i = 0; i < 4 && !projectionChanged; i++)
+        for (int j = 0; j < 4 && !projectionChanged; j++)
+            projectionChanged = proj[i][j] != projection[i][j];
+
+    if (projectionChanged) {
+        zNear = near;
+        zFar = far;
+        projection = proj;
+        screenSize = currentScreen;
+        buildClusterBounds();
+    }
+
+    // luzes no espaço de visão e distribuição por fatia Z
+    std::vector<glm::vec4> viewLights(lights.size());
+    std::vector<glm::ivec4> tileRanges(lights.size());
+    std::vector<std::vector<int>> lightsBySlice(CLUSTER_Z);
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        float radius = lights[i].radius;
+        viewLights[i] = glm::vec4(center, radius);
+        tileRanges[i] = tileRange(center, radius);
+
+        float depthMin = -center.z - radius;
+        float depthMax = -center.z + radius;
+        if (depthMax < zNear || depthMin > zFar || tileRanges[i].z < tileRanges[i].x)
+            continue;
+
+        int zBegin = sliceForDepth(depthMin);
+        int zEnd = sliceForDepth(depthMax);
+        for (int z = zBegin; z <= zEnd; z++)
+            lightsBySlice[z].push_back((int)i);
+    }
+
+    std::vector<std::vector<GLuint>> clusterLists(CLUSTER_COUNT);
+
+    unsigned int threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)CLUSTER_Z));
+    if (lights.size() < CLUSTER_PARALLEL_THRESHOLD || threadCount == 1) {
+        droppedLights = assignSlices(0, CLUSTER_Z, viewLights, lightsBySlice, tileRanges, clusterLists);
+    } else {
+        std::vector<std::thread> workers;
+        int slicesPerThread = (CLUSTER_Z + threadCount - 1) / threadCount;
+        std::vector<int> dropped((CLUSTER_Z + slicesPerThread - 1) / slicesPerThread, 0);
+        for (int zBegin = 0; zBegin < CLUSTER_Z; zBegin += slicesPerThread) {
+            int zEnd = std::min(zBegin + slicesPerThread, CLUSTER_Z);
+            workers.emplace_back([&, zBegin, zEnd]() {
+                dropped[zBegin / slicesPerThread] = assignSlices(zBegin, zEnd, viewLights, lightsBySlice, tileRanges, clusterLists);
+            });
+        }
+        for (std::thread& t : workers) t.join();
+
+        droppedLights = 0;
+        for (int d : dropped)
+            droppedLights += d;
+    }
+
+    // compacta as listas: (offset, count) por cluster + índices contíguos
+    lightIndices.clear();
+    for (int c = 0; c < CLUSTER_COUNT; c++) {
+        clusterData[c * 2] = (GLuint)lightIndices.size();
+        clusterData[c * 2 + 1] = (GLuint)clusterLists[c].size();
+        lightIndices.insert(lightIndices.end(), clusterLists[c].begin(), clusterLists[c].end());
+    }
+
+    lightData.resize(lights.size() * 2);
+    for (size_t i = 0; i < lights.size(); i++) {
+        lightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+        lightData[i * 2 + 1] = glm::vec4(lights[i].color, lights[i].intensity);
+    }
+
+    // buffers vazios não podem ser associados a texturas
+    if (lightData.empty()) lightData.push_back(glm::vec4(0.0f));
+    if (lightIndices.empty()) lightIndices.push_back(0);
+
+    upload(lightsBuffer, lightData.data(), lightData.size() * sizeof(glm::vec4));
+    upload(gridBuffer, clusterData.data(), clusterData.size() * sizeof(GLuint));
+    upload(indicesBuffer, lightIndices.data(), lightIndices.size() * sizeof(GLuint));
+
+    glBindTexture(GL_TEXTURE_BUFFER, lightsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightsBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, indicesTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indicesBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusterGrid::upload(GLuint buffer, const void* data, size_t size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    // realoca a cada frame (orphaning) para não esperar o frame anterior
+    glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusterGrid::bind(const Shader& s) const {
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, lightsTexture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_INDICES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indicesTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    s.setInt("clusterLights", CLUSTER_LIGHTS_UNIT);
+    s.setInt("clusterGrid", CLUSTER_GRID_UNIT);
+    s.setInt("clusterIndices", CLUSTER_INDICES_UNIT);
+
+    s.setBool("useClusters", true);
+    s.setVec2("clusterTileSize", screenSize / glm::vec2((float)CLUSTER_X, (float)CLUSTER_Y));
+    s.setFloat("clusterNear", zNear);
+    s.setFloat("clusterFar", zFar);
+}
+
+void LightClusterGrid::destroy() {
+    GLuint buffers[3] = {lightsBuffer, gridBuffer, indicesBuffer};
+    GLuint textures[3] = {lightsTexture, gridTexture, indicesTexture};
+    glDeleteBuffers(3, buffers);
+    glDeleteTextures(3, textures);
+}
+
+#endif
@@ -10,6 +10,9 @@
 #include <functional>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.hpp"
+#include "profiler.hpp"
+#include "bvh.hpp"
+#include "wide_bvh.hpp"
 
 #if __has_include(<filesystem>)
     #include <filesystem>
@@ -36,91 +39,29 @@ struct Material {
     std::string bumpTexturePath = "";
 };
 
-struct AABB {
-    glm::vec3 min_corner;
-    glm::vec3 max_corner;
-};
-
-struct AABBNode {
-    AABB box;
-    AABBNode* left = nullptr;
-    AABBNode* right = nullptr;
-
-    std::vector<Vertex> vertices; // Só nas folhas
-    bool isLeaf() const { return left == nullptr && right == nullptr; }
+// Malha já lida e com a BVH pronta, mas sem nada na GPU: pode ser montada
+// em qualquer thread e depois virar um Mesh na thread do contexto OpenGL.
+struct MeshData {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    Material material;
+    std::string baseDir;
 
-    AABB getTransformed(const glm::mat4& transform) const;
+    std::vector<BVHNode> boundingTree;
+    WideBVH<4> wideTree4;
+    WideBVH<8> wideTree8;
+    BVHStats bvhStats;
 
-    ~AABBNode() {
-        delete left;
-        delete right;
-    }
+    void buildBoundingTree();
 };
 
-AABB AABBNode::getTransformed(const glm::mat4& transform) const {
-    glm::vec3 corners[8] = {
-        box.min_corner,
-        glm::vec3(box.min_corner.x, box.min_corner.y, box.max_corner.z),
-        glm::vec3(box.min_corner.x, box.max_corner.y, box.min_corner.z),
-        glm::vec3(box.min_corner.x, box.max_corner.y, box.max_corner.z),
-        glm::vec3(box.max_corner.x, box.min_corner.y, box.min_corner.z),
-        glm::vec3(box.max_corner.x, box.min_corner.y, box.max_corner.z),
-        glm::vec3(box.max_corner.x, box.max_corner.y, box.min_corner.z),
-        box.max_corner
-    };
-
-    glm::vec3 minT = glm::vec3(transform * glm::vec4(corners[0], 1.0f));
-    glm::vec3 maxT = minT;
-
-    for (int i = 1; i < 8; ++i) {
-        glm::vec3 t = glm::vec3(transform * glm::vec4(corners[i], 1.0f));
-        minT = glm::min(minT, t);
-        maxT = glm::max(maxT, t);
-    }
-
-    return AABB{minT, maxT};
-}
-
-AABBNode* buildAABBTree(std::vector<Vertex>& verts, int depth = 0) {
-    if (verts.empty()) return nullptr;
-
-    AABBNode* node = new AABBNode();
-
-    // Calcula o AABB atual
-    glm::vec3 min = verts[0].position;
-    glm::vec3 max = verts[0].position;
-    for (const auto& v : verts) {
-        min = glm::min(min, v.position);
-        max = glm::max(max, v.position);
-    }
-    node->box.min_corner = min;
-    node->box.max_corner = max;
-
-    // Critério de parada: poucos vértices
-    if (verts.size() <= 50 || depth > 10) {
-        node->vertices = verts;
-        return node;
-    }
-
-    // Eixo de divisão: maior eixo (x = 0/y = 1/z = 2)
-    glm::vec3 extent = max - min;
-    int axis = 0;
-    if (extent.y > extent.x) axis = 1;
-    if (extent.z > extent[axis]) axis = 2;
-
-    std::sort(verts.begin(), verts.end(), [axis](const Vertex& a, const Vertex& b) {
-        return a.position[axis] < b.position[axis];
-    });
-
-    // Divisão ao meio
-    size_t mid = verts.size() / 2;
-    std::vector<Vertex> leftVerts(verts.begin(), verts.begin() + mid);
-    std::vector<Vertex> rightVerts(verts.begin() + mid, verts.end());
-
-    node->left = buildAABBTree(leftVerts, depth + 1);
-    node->right = buildAABBTree(rightVerts, depth + 1);
-
-    return node;
+// a BVH reordena os triângulos do index buffer, então vem antes do upload
+void MeshData::buildBoundingTree() {
+    PROFILE_SCOPE("buildAABBTree");
+    boundingTree = buildAABBTree(vertices, indices, bvhStats);
+    wideTree4.build(boundingTree);
+    wideTree8.build(boundingTree);
 }
 
 // represent any drawable object
@@ -134,16 +75,24 @@ struct Mesh {
 
     GLuint VAO, VBO, EBO;
 
-    AABBNode* boundingTree = nullptr;
+    std::vector<BVHNode> boundingTree;
+    WideBVH<4> wideTree4;
+    WideBVH<8> wideTree8;
+    BVHStats bvhStats;
 
     Mesh(std::string n, const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir);
     Mesh(const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir);
+    Mesh(MeshData&& data);
 
     void draw(const Shader &s) const;
+    void drawGeometry() const;
     void setup_mesh();
     void load_texture(const char* path);
     void destroy_mesh();
 
+    void getTriangle(GLuint triangle, glm::vec3& a, glm::vec3& b, glm::vec3& c) const;
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, int bvhWidth) const;
+
 /*     void drawAABB(const Shader& s, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
  */
     void drawBoundingTree(const Shader& shader, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
@@ -196,19 +145,10 @@ void drawAABB(const Shader& shader, const glm::mat4& model, const glm::mat4& vie
 }
 
 void Mesh::drawBoundingTree(const Shader& shader, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const {
-    std::function<void(const AABBNode*)> drawRecursive = [&](const AABBNode* node) {
-        if (!node) return;
-
-        // Desenhar o AABB desse nó
-        if (node->isLeaf())
-            drawAABB(shader, model * glm::mat4(1.0f), view, projection, node->box);
-
-        // Recursivamente desenhar filhos
-        drawRecursive(node->left);
-        drawRecursive(node->right);
-    };
-
-    drawRecursive(boundingTree);
+    // Desenhar o AABB de cada folha
+    for (const BVHNode& node : boundingTree)
+        if (node.isLeaf())
+            drawAABB(shader, model, view, projection, node.box());
 }
 
 /* void Mesh::drawAABB(const Shader& s, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const {
@@ -272,11 +212,32 @@ void Mesh::drawBoundingTree(const Shader& shader, const glm::mat4& model, const
     glDeleteVertexArrays(1, &vao);
 } */
 
-Mesh::Mesh(std::string n, const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir): Mesh(v, i, m, baseDir) {
-    name = n;
+Mesh::Mesh(std::string n, const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir): Mesh(MeshData{n, v, i, m, baseDir}) {
+}
+
+Mesh::Mesh(const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir): Mesh(MeshData{"", v, i, m, baseDir}) {
 }
 
-Mesh::Mesh(const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Material& m, const std::string& baseDir): vertices(v), indices(i), material(m) {
+// Só a parte que precisa do contexto OpenGL: texturas e buffers
+Mesh::Mesh(MeshData&& data) {
+    PROFILE_SCOPE("Mesh");
+
+    // dados montados fora de load_mesh_data ainda não têm a BVH
+    if (data.boundingTree.empty())
+        data.buildBoundingTree();
+
+    name = std::move(data.name);
+    vertices = std::move(data.vertices);
+    indices = std::move(data.indices);
+    material = std::move(data.material);
+    boundingTree = std::move(data.boundingTree);
+    wideTree4 = std::move(data.wideTree4);
+    wideTree8 = std::move(data.wideTree8);
+    bvhStats = data.bvhStats;
+
+    const std::string& baseDir = data.baseDir;
+    const Material& m = material;
+
     if (!m.diffuseTexturePath.empty()) {
         fs::path base(baseDir);
         fs::path relative(material.diffuseTexturePath);
@@ -300,9 +261,36 @@ Mesh::Mesh(const std::vector<Vertex> &v, const std::vector<GLuint> &i, const Mat
         fs::path fullPath = fs::weakly_canonical(base / relative);
         load_texture(fullPath.string().c_str());
     }
-    
+
     setup_mesh();
-    boundingTree = buildAABBTree(vertices);
+}
+
+void Mesh::getTriangle(GLuint triangle, glm::vec3& a, glm::vec3& b, glm::vec3& c) const {
+    a = vertices[indices[triangle * 3]].position;
+    b = vertices[indices[triangle * 3 + 1]].position;
+    c = vertices[indices[triangle * 3 + 2]].position;
+}
+
+// Triângulo mais próximo no espaço da malha; distance entra como limite e sai com o acerto
+bool Mesh::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, int bvhWidth = 2) const {
+    bool hit = false;
+    auto leaf = [&](GLuint first, GLuint count) {
+        for (GLuint t = first; t < first + count; t++) {
+            glm::vec3 a, b, c;
+            float tHit;
+            getTriangle(t, a, b, c);
+            if (rayIntersectsTriangle(origin, direction, a, b, c, tHit) && tHit < distance) {
+                distance = tHit;
+                hit = true;
+            }
+        }
+        return distance;
+    };
+
+    if (bvhWidth == 8) wideTree8.raycast(origin, direction, distance, leaf);
+    else if (bvhWidth == 4) wideTree4.raycast(origin, direction, distance, leaf);
+    else bvhRaycast(boundingTree, origin, direction, distance, leaf);
+    return hit;
 }
 
 void Mesh::draw(const Shader &s) const {
@@ -353,7 +341,15 @@ void Mesh::draw(const Shader &s) const {
     glBindVertexArray(0);
 }
 
+// só a geometria, sem material (passes de profundidade)
+void Mesh::drawGeometry() const {
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
 void Mesh::setup_mesh() {
+    PROFILE_FUNCTION();
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -382,6 +378,7 @@ void Mesh::setup_mesh() {
 }
 
 void Mesh::load_texture(const char* path) {
+    PROFILE_FUNCTION();
     GLuint textureID;
     glGenTextures(1, &textureID);
 
@@ -431,8 +428,9 @@ void Mesh::destroy_mesh() {
         glDeleteTextures(1, &tex);
     }
 
-    delete boundingTree;
-    boundingTree = nullptr;
+    boundingTree.clear();
+    wideTree4.nodes.clear();
+    wideTree8.nodes.clear();
 }
 
 #endif
\ No newline at end of file
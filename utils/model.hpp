@@ -5,12 +5,20 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <string>
 #include <vector>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 #include "shaders.hpp"
 #include "mesh.hpp"
 #include "read_obj_file.hpp"
+#include "lights.hpp"
+#include "shadow.hpp"
+#include "rigid_body.hpp"
+#include "convex.hpp"
 
 enum TransformType {
     SCALE,
@@ -22,57 +30,92 @@ struct Light {
     glm::vec3 color;
 };
 
-struct Object {
+// Pose como posição, quaternion unitário e escala; a matriz só é montada
+// quando pedida. Rotações são locais (à direita), como antes com matrizes.
+struct Transforms {
     glm::vec3 position = glm::vec3(0.0f);
-    glm::vec3 displacedPosition = glm::vec3(0.0f);// posição suavizada com inércia
-    glm::vec3 velocity = glm::vec3(0.0f);
-    glm::vec3 size = glm::vec3(0.0f);
-    GLfloat mass = 0; 
-    
-    glm::vec3 angularVelocity = glm::vec3(0.0f);  // Velocidade angular (torque)
-    GLfloat angularDamping = 0.99f;  // Damping para as rotações (ajuste conforme necessário)
+    glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    void addTranslate(const glm::vec3& t) { position += t; }
+    void addRotate(const glm::quat& q) { orientation = glm::normalize(orientation * q); }
+    void addScale(const glm::vec3& s) { scale *= s; }
 
-    void incrementVelocity(glm::vec3 v);
+    glm::mat4 getModelMatrix() const;
 };
 
-void Object::incrementVelocity(glm::vec3 v = glm::vec3(0.01f)) {
-    velocity += v;
+// translate * rotate * scale sem multiplicar matrizes: colunas da rotação
+// escaladas e a posição na última coluna
+glm::mat4 Transforms::getModelMatrix() const {
+    glm::mat3 rotation = glm::mat3_cast(orientation);
+    glm::mat4 matrix(1.0f);
+    matrix[0] = glm::vec4(rotation[0] * scale.x, 0.0f);
+    matrix[1] = glm::vec4(rotation[1] * scale.y, 0.0f);
+    matrix[2] = glm::vec4(rotation[2] * scale.z, 0.0f);
+    matrix[3] = glm::vec4(position, 1.0f);
+    return matrix;
 }
 
-struct Transforms {
-    glm::mat4 translate = glm::mat4(1.0f);
-    glm::mat4 rotate = glm::mat4(1.0f);
-    glm::mat4 scale = glm::mat4(1.0f);
+// Conteúdo de um arquivo de modelo pronto para a GPU (ver MeshData)
+struct ModelData {
+    std::string name;
+    std::vector<MeshData> meshes;
+    std::vector<ConvexHull> hulls;  // um por malha
+};
 
-    void addTranslate(const glm::mat4& m) { translate = translate * m; }
-    void addRotate(const glm::mat4& m) { rotate = rotate * m; }
-    void addScale(const glm::mat4& m) { scale = scale * m; }
+ModelData loadModelData(const std::string& model_file) {
+    ModelData data;
+    // data/<nome>/source/model.obj
+    data.name = fs::path(model_file).parent_path().parent_path().filename().string();
+    data.meshes = load_mesh_data(model_file);
+    data.hulls = loadOrBuildConvexHulls(model_file, data.meshes);
+    return data;
+}
 
-    glm::mat4 getModelMatrix() const {
-        return translate * rotate * scale;
+// Lê os arquivos e constrói as BVHs com uma thread por arquivo; o resultado
+// segue a ordem de files. Os Models em si são criados depois, na thread do contexto.
+std::vector<ModelData> loadModelsParallel(const std::vector<std::string>& files) {
+    PROFILE_FUNCTION();
+    std::vector<ModelData> data(files.size());
+    std::vector<std::thread> workers;
+    workers.reserve(files.size());
+
+    for (size_t i = 0; i < files.size(); i++) {
+        workers.emplace_back([&, i] {
+            Profiler::instance().setThreadName("load " + files[i]);
+            data[i] = loadModelData(files[i]);
+        });
     }
-};
+
+    for (std::thread& worker : workers)
+        worker.join();
+    return data;
+}
 
 struct Model {
-    Object object;
+    std::string name;
+    BodyHandle body;  // estado dinâmico fica no RigidBodyWorld
     Shader shader;
     Shader aabbShader;
     std::vector<Mesh> meshes;
+    std::vector<ConvexHull> hulls;  // proxies de colisão, no espaço do modelo
     AABB modelAABB;
 
-    glm::mat4 model;
-
     // non-cumulative effect matrix
     glm::mat4 effect;
     
-    // cumulative transforms
+    // cumulative transforms; com corpo, posição e orientação espelham o mundo
     Transforms transforms;
+
+    // matriz interpolada para o desenho; só a thread de desenho lê e escreve
+    glm::mat4 renderMatrix = glm::mat4(1.0f);
     
     bool valid = false;
     
     Model(std::string model_file, const char* vertexPath, const char* fragmentPath);
+    Model(ModelData&& data, const char* vertexPath, const char* fragmentPath);
 
-    void setModelMass(GLfloat mass);
+    void attachBody(RigidBodyWorld& world, GLfloat mass);
 
     void translate(glm::vec3 translate_vector);
     void scale(glm::vec3 scale_vector);
@@ -80,9 +123,11 @@ struct Model {
 
     void applyEffect(TransformType type, glm::vec3 t, GLfloat a);
     void clearEffect();
-    void updateModelMatrix();
+    void syncBody();
+    const glm::mat4& modelMatrix() const;
 
     glm::vec3 getPosition() const;
+    glm::vec3 getCenterOfMass() const;
 
     void draw(
         glm::mat4 &view,
@@ -90,16 +135,30 @@ struct Model {
         glm::vec3 lightPosition,
         glm::vec3 lightColor,
         glm::vec3 viewPosition,
-        bool showAABB
+        bool showAABB,
+        const LightClusterGrid* clusters,
+        const ShadowMap* shadows
     );
+    void drawDepth(const Shader& depthShader, bool withEffect) const;
+    void drawBoundingTrees(glm::mat4 &view, glm::mat4 &projection) const;
 
     void setInitialGlobalAABB();
     AABB getGlobalAABB();
+    AABB getWorldAABB() const;
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, int bvhWidth) const;
+    void printBVHStats() const;
     void destroy();
+
+private:
+    // translate * rotate * scale, refeita só depois de uma mudança
+    mutable glm::mat4 model = glm::mat4(1.0f);
+    mutable bool modelDirty = true;
 };
 
-void Model::setModelMass(GLfloat mass) {
-    object.mass = mass;
+// Cria o corpo na pose atual; daí em diante translate e rotate movem o corpo
+void Model::attachBody(RigidBodyWorld& world, GLfloat mass) {
+    body.world = &world;
+    body.index = world.add(transforms.position, transforms.orientation, mass);
 }
 
 void Model::applyEffect(TransformType type, glm::vec3 t, GLfloat a = 0.0f) {
@@ -117,7 +176,13 @@ void Model::clearEffect() {
 }
 
 glm::vec3 Model::getPosition() const {
-    return glm::vec3(model[3]); // Pega a coluna da translação
+    return transforms.position;
+}
+
+// Centro da caixa local no mundo (densidade uniforme)
+glm::vec3 Model::getCenterOfMass() const {
+    glm::vec3 center = (modelAABB.min_corner + modelAABB.max_corner) * 0.5f;
+    return glm::vec3(effect * modelMatrix() * glm::vec4(center, 1.0f));
 }
 
 void Model::setInitialGlobalAABB() {
@@ -129,30 +194,11 @@ void Model::setInitialGlobalAABB() {
     glm::vec3 globalMin(FLT_MAX);
     glm::vec3 globalMax(-FLT_MAX);
 
-    auto transformAABBNode = [&](const AABBNode* node, auto&& self_ref) -> void {
-        if (!node) return;
-
-        const glm::vec3& min = node->box.min_corner;
-        const glm::vec3& max = node->box.max_corner;
-
-        glm::vec3 corners[8] = {
-            {min.x, min.y, min.z}, {max.x, min.y, min.z},
-            {max.x, max.y, min.z}, {min.x, max.y, min.z},
-            {min.x, min.y, max.z}, {max.x, min.y, max.z},
-            {max.x, max.y, max.z}, {min.x, max.y, max.z}
-        };
-
-        for (const glm::vec3& corner : corners) {
-            globalMin = glm::min(globalMin, corner);
-            globalMax = glm::max(globalMax, corner);
-        }
-
-        self_ref(node->left, self_ref);
-        self_ref(node->right, self_ref);
-    };
-
+    // a raiz de cada BVH já envolve a malha inteira
     for (const auto& mesh : meshes) {
-        transformAABBNode(mesh.boundingTree, transformAABBNode);
+        if (mesh.boundingTree.empty()) continue;
+        globalMin = glm::min(globalMin, mesh.boundingTree[0].min_corner);
+        globalMax = glm::max(globalMax, mesh.boundingTree[0].max_corner);
     }
 
     modelAABB.min_corner = globalMin;
@@ -160,7 +206,7 @@ void Model::setInitialGlobalAABB() {
 }
 
 AABB Model::getGlobalAABB() {
-    glm::mat4 transform = effect * model;
+    glm::mat4 transform = effect * modelMatrix();
      
     glm::vec3 min_corner = glm::vec3(transform * glm::vec4(modelAABB.min_corner, 1.0f));
     glm::vec3 max_corner = glm::vec3(transform * glm::vec4(modelAABB.max_corner, 1.0f));
@@ -168,11 +214,65 @@ AABB Model::getGlobalAABB() {
     return AABB{min_corner, max_corner};
 }
 
-Model::Model(std::string model_file, const char* vertexPath, const char* fragmentPath): shader(vertexPath, fragmentPath), aabbShader("shaders/aabb.vs.shader", "shaders/aabb.fs.shader") {
-    meshes = generate_mesh_from_file(model_file);
+// Caixa conservadora no mundo, válida também com rotação (usada pela broadphase)
+AABB Model::getWorldAABB() const {
+    return transformAABB(modelAABB, effect * modelMatrix());
+}
+
+// Raio no mundo contra os triângulos como estão desenhados (renderMatrix); a
+// direção vai para o espaço do modelo sem normalizar, então distance continua
+// medida no parâmetro do raio do mundo
+bool Model::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, int bvhWidth = 2) const {
+    glm::mat4 toLocal = glm::inverse(renderMatrix);
+    glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+
+    bool hit = false;
+    for (const Mesh& mesh : meshes)
+        hit |= mesh.raycast(localOrigin, localDirection, distance, bvhWidth);
+    return hit;
+}
+
+// Uma linha por modelo; o custo SAH é a média das malhas ponderada por triângulos
+void Model::printBVHStats() const {
+    BVHStats total;
+    float weightedCost = 0.0f;
+    size_t wideNodes4 = 0, wideNodes8 = 0;
+    for (const Mesh& mesh : meshes) {
+        wideNodes4 += mesh.wideTree4.nodes.size();
+        wideNodes8 += mesh.wideTree8.nodes.size();
+        total.triangles += mesh.bvhStats.triangles;
+        total.nodes += mesh.bvhStats.nodes;
+        total.leaves += mesh.bvhStats.leaves;
+        total.maxDepth = std::max(total.maxDepth, mesh.bvhStats.maxDepth);
+        weightedCost += mesh.bvhStats.sahCost * mesh.bvhStats.triangles;
+    }
+    total.sahCost = total.triangles ? weightedCost / total.triangles : 0.0f;
+
+    std::ostringstream line;
+    line << "  " << std::left << std::setw(12) << name << std::right
+         << std::setw(8) << total.triangles << " tris"
+         << std::setw(8) << total.nodes << " nós"
+         << std::setw(7) << total.leaves << " folhas"
+         << "  prof. " << std::setw(2) << total.maxDepth
+         << "  SAH " << std::fixed << std::setprecision(2) << total.sahCost
+         << "  largos 4/8: " << wideNodes4 << "/" << wideNodes8 << " nós";
+    std::cout << line.str() << std::endl;
+}
+
+Model::Model(std::string model_file, const char* vertexPath, const char* fragmentPath): Model(loadModelData(model_file), vertexPath, fragmentPath) {
+}
+
+Model::Model(ModelData&& data, const char* vertexPath, const char* fragmentPath): shader(vertexPath, fragmentPath), aabbShader("shaders/aabb.vs.shader", "shaders/aabb.fs.shader") {
+    PROFILE_SCOPE("Model");
+
+    name = std::move(data.name);
+    hulls = std::move(data.hulls);
+    meshes.reserve(data.meshes.size());
+    for (MeshData& mesh : data.meshes)
+        meshes.emplace_back(std::move(mesh));
 
     if(shader.initialized) {
-        model = glm::mat4(1.0f);
         effect = glm::mat4(1.0f);
         valid = true;
 
@@ -180,26 +280,40 @@ Model::Model(std::string model_file, const char* vertexPath, const char* fragmen
     }
 };
 
-void Model::updateModelMatrix() {
-    model = transforms.getModelMatrix();
+// Depois de integrar o mundo: a pose do corpo volta para transforms
+void Model::syncBody() {
+    if (!body.valid()) return;
+    transforms.position = body.world->position(body.index);
+    transforms.orientation = body.world->orientation(body.index);
+    modelDirty = true;
+}
+
+// Não é seguro chamar de duas threads enquanto houver mudança pendente
+const glm::mat4& Model::modelMatrix() const {
+    if (modelDirty) {
+        model = transforms.getModelMatrix();
+        modelDirty = false;
+    }
+    return model;
 }
 
 void Model::translate(glm::vec3 translate_vector) {
-    glm::mat4 t = glm::translate(glm::mat4(1.0f), translate_vector);
-    transforms.addTranslate(t);
-    updateModelMatrix();
+    transforms.addTranslate(translate_vector);
+    if (body.valid())
+        body.world->setPosition(body.index, transforms.position);
+    modelDirty = true;
 }
 
 void Model::scale(glm::vec3 scale_vector) {
-    glm::mat4 t = glm::scale(glm::mat4(1.0f), scale_vector);
-    transforms.addScale(t);
-    updateModelMatrix();
+    transforms.addScale(scale_vector);
+    modelDirty = true;
 }
 
 void Model::rotate(GLfloat angle, glm::vec3 rotate_vector) {
-    glm::mat4 t = glm::rotate(glm::mat4(1.0f), glm::radians(angle), rotate_vector);
-    transforms.addRotate(t);
-    updateModelMatrix();
+    transforms.addRotate(glm::angleAxis(glm::radians(angle), glm::normalize(rotate_vector)));
+    if (body.valid())
+        body.world->setOrientation(body.index, transforms.orientation);
+    modelDirty = true;
 }
 
 void Model::draw(
@@ -208,13 +322,13 @@ void Model::draw(
     glm::vec3 lightPosition = glm::vec3(0.0f, 0.0f, 50.0f),
     glm::vec3 lightColor = glm::vec3(1.0f),
     glm::vec3 viewPosition = glm::vec3(0.0f, 0.0f, 50.0f),
-    bool showAABB = false
+    bool showAABB = false,
+    const LightClusterGrid* clusters = nullptr,
+    const ShadowMap* shadows = nullptr
 ) {
     shader.use();
 
-    glm::mat4 modelWithEffect = effect * model;
-
-    shader.setMat4("model", glm::value_ptr(modelWithEffect));
+    shader.setMat4("model", glm::value_ptr(renderMatrix));
     shader.setMat4("view", glm::value_ptr(view));
     shader.setMat4("projection", glm::value_ptr(projection));
 
@@ -222,17 +336,51 @@ void Model::draw(
     shader.setVec3("lightColor", lightColor);
 
     shader.setVec3("viewPos", viewPosition);
+
+    if (clusters) {
+        clusters->bind(shader);
+    } else {
+        // samplers de buffer precisam de unidades próprias mesmo sem uso
+        shader.setBool("useClusters", false);
+        shader.setInt("clusterLights", CLUSTER_LIGHTS_UNIT);
+        shader.setInt("clusterGrid", CLUSTER_GRID_UNIT);
+        shader.setInt("clusterIndices", CLUSTER_INDICES_UNIT);
+    }
+
+    if (shadows) {
+        shadows->bind(shader);
+    } else {
+        shader.setBool("useShadows", false);
+        shader.setInt("shadowMap", SHADOW_UNIT);
+    }
     
     for (const auto& mesh: meshes) {
         mesh.draw(shader);
         if(showAABB) {
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            mesh.drawBoundingTree(shader, model, view, projection);
+            mesh.drawBoundingTree(shader, renderMatrix, view, projection);
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         }
     }
 }
 
+// Desenha só a profundidade com o shader do shadow map (já em uso)
+void Model::drawDepth(const Shader& depthShader, bool withEffect) const {
+    glm::mat4 transform = withEffect ? renderMatrix : modelMatrix();
+    depthShader.setMat4("model", glm::value_ptr(transform));
+
+    for (const auto& mesh: meshes)
+        mesh.drawGeometry();
+}
+
+// Overlay das folhas da árvore de AABBs em wireframe
+void Model::drawBoundingTrees(glm::mat4 &view, glm::mat4 &projection) const {
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    for (const auto& mesh: meshes)
+        mesh.drawBoundingTree(aabbShader, renderMatrix, view, projection);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
 void Model::destroy() {
     for (auto& mesh: meshes)
         mesh.destroy_mesh();
@@ -0,0 +1,166 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "model.hpp"
+#include "profiler.hpp"
+
+#define TRIPLE_BUFFER_FRESH 4  // bit no índice do meio: publicado e ainda não lido
+
+// Um escritor e um leitor sem lock: cada lado tem o seu buffer e o do meio
+// é trocado por exchange. O leitor sempre pega o último publicado; o escritor
+// nunca espera o leitor.
+template <typename T>
+struct TripleBuffer {
+    T& writeBuffer() { return buffers[back]; }
+    void publish();
+
+    bool update();
+    const T& readBuffer() const { return buffers[front]; }
+
+private:
+    T buffers[3];
+    std::atomic<int> middle{1};
+    int back = 0;   // só o escritor
+    int front = 2;  // só o leitor
+};
+
+template <typename T>
+void TripleBuffer<T>::publish() {
+    back = middle.exchange(back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+}
+
+// Troca o buffer de leitura pelo último publicado; false se não há nada novo
+template <typename T>
+bool TripleBuffer<T>::update() {
+    if (!(middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH))
+        return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+    return true;
+}
+
+// Transformações de um corpo no passo anterior e no atual da física
+struct BodyState {
+    Transforms previous;
+    Transforms current;
+    glm::mat4 previousEffect = glm::mat4(1.0f);
+    glm::mat4 effect = glm::mat4(1.0f);
+
+    void capture(const Model& model);
+    glm::mat4 interpolate(float alpha) const;
+};
+
+// Chamado ao fim de cada passo: o atual vira o anterior
+void BodyState::capture(const Model& model) {
+    previous = current;
+    previousEffect = effect;
+    current = model.transforms;
+    effect = model.effect;
+}
+
+// Posição linear, rotação por slerp; a escala não muda entre passos.
+// Do efeito só a translação é interpolada (o tremor da sala).
+glm::mat4 BodyState::interpolate(float alpha) const {
+    Transforms pose = current;
+    pose.position = glm::mix(previous.position, current.position, alpha);
+    pose.orientation = glm::slerp(previous.orientation, current.orientation, alpha);
+
+    glm::mat4 interpolatedEffect = effect;
+    interpolatedEffect[3] = glm::mix(previousEffect[3], effect[3], alpha);
+    return interpolatedEffect * pose.getModelMatrix();
+}
+
+// O que a física publica para o desenho a cada frame
+struct PhysicsSnapshot {
+    std::vector<BodyState> bodies;
+    float alpha = 1.0f;  // fração do próximo passo já acumulada
+};
+
+// Roda os frames da física numa thread própria, um por vez: submit entrega o
+// tempo do frame e volta logo; wait bloqueia até esse frame terminar. Nada de
+// GL roda aqui. Com threaded = false submit executa o frame na hora.
+struct PhysicsThread {
+    bool threaded = true;
+
+    void start(std::function<void(double)> frame);
+    void submit(double frameTime);
+    void wait();
+    void stop();
+
+private:
+    std::function<void(double)> work;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    double pendingTime = 0.0;
+    bool pending = false;
+    bool quit = false;
+
+    void run();
+};
+
+void PhysicsThread::start(std::function<void(double)> frame) {
+    work = std::move(frame);
+    if (threaded)
+        worker = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::submit(double frameTime) {
+    if (!threaded) {
+        work(frameTime);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return !pending; });
+    pendingTime = frameTime;
+    pending = true;
+    condition.notify_all();
+}
+
+void PhysicsThread::wait() {
+    if (!threaded) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return !pending; });
+}
+
+void PhysicsThread::stop() {
+    if (!worker.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        condition.notify_all();
+    }
+    worker.join();
+}
+
+void PhysicsThread::run() {
+    Profiler::instance().setThreadName("physics");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [&] { return pending || quit; });
+        if (!pending) break;
+
+        double frameTime = pendingTime;
+        lock.unlock();
+        work(frameTime);
+        lock.lock();
+
+        pending = false;
+        condition.notify_all();
+    }
+}
+
+#endif
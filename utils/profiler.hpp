@@ -0,0 +1,262 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "gpu_profiler.hpp"
+
+#define PROFILER_CHUNK_EVENTS 4096
+#define PROFILER_MAX_CHUNKS 256   // por thread: ~1M eventos
+
+// PROFILE_SCOPE("nome") mede até o fim do bloco; o nome precisa ter vida estática
+#ifdef DISABLE_PROFILER
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_FUNCTION()
+#else
+    #define PROFILE_CONCAT_INNER(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+    #define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#endif
+
+struct ProfileEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+struct ProfileChunk {
+    ProfileEvent events[PROFILER_CHUNK_EVENTS];
+    std::atomic<size_t> count{0};
+    std::atomic<ProfileChunk*> next{nullptr};
+};
+
+// Buffer de uma thread: só a thread dona escreve, então gravar um evento não
+// usa lock; o leitor enxerga apenas eventos já publicados pelo store em count.
+// Buffers de threads encerradas são reaproveitados por novas threads (mesma
+// "faixa" no trace), o que limita a memória com threads de vida curta.
+struct ProfileThreadBuffer {
+    int lane = 0;
+    std::string name;
+
+    ProfileChunk* head = nullptr;  // só o registro mexe, sob registryMutex
+    ProfileChunk* tail = nullptr;  // só a thread dona acessa
+    size_t skip = 0;               // eventos de head já descartados por clear()
+    std::atomic<size_t> chunkCount{0};
+    std::atomic<bool> inUse{false};
+    std::atomic<size_t> dropped{0};
+
+    void record(const char* name, int64_t startNs, int64_t endNs);
+
+    ~ProfileThreadBuffer() {
+        ProfileChunk* chunk = head;
+        while (chunk) {
+            ProfileChunk* next = chunk->next.load(std::memory_order_relaxed);
+            delete chunk;
+            chunk = next;
+        }
+    }
+};
+
+void ProfileThreadBuffer::record(const char* eventName, int64_t startNs, int64_t endNs) {
+    size_t count = tail->count.load(std::memory_order_relaxed);
+
+    if (count == PROFILER_CHUNK_EVENTS) {
+        if (chunkCount.load(std::memory_order_relaxed) == PROFILER_MAX_CHUNKS) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ProfileChunk* chunk = new ProfileChunk();
+        tail->next.store(chunk, std::memory_order_release);
+        tail = chunk;
+        chunkCount.fetch_add(1, std::memory_order_relaxed);
+        count = 0;
+    }
+
+    tail->events[count] = ProfileEvent{eventName, startNs, endNs};
+    tail->count.store(count + 1, std::memory_order_release);
+}
+
+class Profiler {
+    public:
+        static Profiler& instance();
+
+        std::atomic<bool> enabled{true};
+
+        int64_t now() const;
+        ProfileThreadBuffer* threadBuffer();
+        void setThreadName(const std::string& name);
+
+        bool writeChromeTrace(const std::string& path, const GpuProfiler* gpu);
+        void clear();
+
+    private:
+        Profiler(): epoch(std::chrono::steady_clock::now()) {}
+
+        std::chrono::steady_clock::time_point epoch;
+        std::mutex registryMutex;  // só ao registrar/liberar threads e ao exportar
+        std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+
+        ProfileThreadBuffer* acquireBuffer();
+
+        friend struct ProfileThreadHandle;
+};
+
+// Devolve o buffer ao registro quando a thread termina
+struct ProfileThreadHandle {
+    ProfileThreadBuffer* buffer = nullptr;
+
+    ~ProfileThreadHandle() {
+        if (buffer)
+            buffer->inUse.store(false, std::memory_order_release);
+    }
+};
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+ProfileThreadBuffer* Profiler::acquireBuffer() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for (auto& buffer : buffers) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true))
+            return buffer.get();
+    }
+
+    auto buffer = std::make_unique<ProfileThreadBuffer>();
+    buffer->lane = (int)buffers.size();
+    buffer->name = "thread " + std::to_string(buffer->lane);
+    buffer->head = buffer->tail = new ProfileChunk();
+    buffer->chunkCount = 1;
+    buffer->inUse = true;
+
+    buffers.push_back(std::move(buffer));
+    return buffers.back().get();
+}
+
+ProfileThreadBuffer* Profiler::threadBuffer() {
+    thread_local ProfileThreadHandle handle;
+    if (!handle.buffer)
+        handle.buffer = acquireBuffer();
+    return handle.buffer;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ProfileThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+// Exporta no formato trace_event (chrome://tracing, Perfetto), com as zonas da GPU opcionalmente
+bool Profiler::writeChromeTrace(const std::string& path, const GpuProfiler* gpu = nullptr) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever trace: " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"CPU\"}}";
+
+    size_t dropped = 0;
+    for (const auto& buffer : buffers) {
+        file << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->lane << ", \"args\": {\"name\": ";
+        writeTraceString(file, buffer->name);
+        file << "}}";
+
+        for (ProfileChunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = chunk == buffer->head ? buffer->skip : 0; i < count; i++) {
+                const ProfileEvent& e = chunk->events[i];
+                file << ",\n{\"name\": ";
+                writeTraceString(file, e.name);
+                file << ", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->lane
+                     << ", \"ts\": " << e.startNs / 1000.0
+                     << ", \"dur\": " << (e.endNs - e.startNs) / 1000.0 << "}";
+            }
+        }
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    if (gpu) {
+        // traceUs da GPU é relativo ao init do GpuProfiler; alinha com o epoch da CPU
+        double offsetUs = std::chrono::duration<double, std::micro>(gpu->cpuEpoch - epoch).count();
+
+        file << ",\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"GPU\"}}";
+        for (const GpuFrameResult& frame : gpu->history) {
+            for (const GpuZoneResult& zone : frame.zones) {
+                file << ",\n{\"name\": ";
+                writeTraceString(file, zone.name);
+                file << ", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0"
+                     << ", \"ts\": " << offsetUs + zone.traceUs
+                     << ", \"dur\": " << zone.durationMs * 1000.0
+                     << ", \"args\": {\"frame\": " << frame.frame << "}}";
+            }
+        }
+    }
+
+    file << "\n]}\n";
+
+    if (dropped > 0)
+        std::cerr << "Profiler: " << dropped << " eventos descartados (buffer cheio)" << std::endl;
+    return true;
+}
+
+// Descarta o que já foi exportado, para a próxima captura não repetir os
+// eventos. A thread dona só escreve no último bloco, que nunca é liberado:
+// dele só se anota quantos eventos já existiam.
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for (auto& buffer : buffers) {
+        ProfileChunk* last = buffer->head;
+        size_t freed = 0;
+        while (ProfileChunk* next = last->next.load(std::memory_order_acquire)) {
+            delete last;
+            last = next;
+            freed++;
+        }
+        buffer->head = last;
+        buffer->skip = last->count.load(std::memory_order_acquire);
+        buffer->chunkCount.fetch_sub(freed, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Zona RAII usada por PROFILE_SCOPE
+struct ProfileZone {
+    const char* name;
+    int64_t start;
+    bool active;
+
+    explicit ProfileZone(const char* n): name(n), start(0), active(Profiler::instance().enabled.load(std::memory_order_relaxed)) {
+        if (active) start = Profiler::instance().now();
+    }
+
+    ~ProfileZone() {
+        if (!active) return;
+        Profiler& profiler = Profiler::instance();
+        profiler.threadBuffer()->record(name, start, profiler.now());
+    }
+};
+
+#endif
@@ -31,6 +31,7 @@ void read_mtl_file(
     const std::string& path,
     std::unordered_map<std::string, Material>& materialMap
 ) {
+    PROFILE_FUNCTION();
     std::ifstream file(path);
     if (!file.is_open()) {
         std::cerr << "Erro ao abrir arquivo MTL: " << path << std::endl;
@@ -107,6 +108,7 @@ void read_obj_file(
     std::vector<Face> &mFaces,
     std::unordered_map<std::string, Material> &mMaterials
 ) {
+    PROFILE_FUNCTION();
     std::ifstream file(path);
     std::string line;
 
@@ -248,7 +250,9 @@ namespace std {
     };
 }
 
-std::vector<Mesh> generate_mesh_from_file(std::string path) {
+// Parte da carga que não usa OpenGL: leitura, agrupamento e BVHs
+std::vector<MeshData> load_mesh_data(std::string path) {
+    PROFILE_FUNCTION();
     std::vector<glm::vec3> positions;
     std::vector<glm::vec2> texCoords;
     std::vector<glm::vec3> normals;
@@ -265,7 +269,8 @@ std::vector<Mesh> generate_mesh_from_file(std::string path) {
         facesByKey[key].push_back(face);
     }
 
-    std::vector<Mesh> meshes;
+    std::vector<MeshData> meshes;
+    meshes.reserve(facesByKey.size());
 
     for (const auto& [key, faceGroup] : facesByKey) {
         std::vector<Vertex> vertices;
@@ -300,10 +305,22 @@ std::vector<Mesh> generate_mesh_from_file(std::string path) {
         Material mat = materials.count(key.material) ? materials[key.material] : Material();
         
         std::string mesh_name = key.get_key();
-        meshes.emplace_back(mesh_name, vertices, indices, mat, baseDir);
+        meshes.push_back(MeshData{mesh_name, std::move(vertices), std::move(indices), mat, baseDir});
+        meshes.back().buildBoundingTree();
     }
 
     return meshes;
 }
 
+std::vector<Mesh> generate_mesh_from_file(std::string path) {
+    PROFILE_FUNCTION();
+    std::vector<MeshData> data = load_mesh_data(path);
+
+    std::vector<Mesh> meshes;
+    meshes.reserve(data.size());
+    for (MeshData& mesh : data)
+        meshes.emplace_back(std::move(mesh));
+    return meshes;
+}
+
 #endif
\ No newline at end of file
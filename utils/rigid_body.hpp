@@ -0,0 +1,339 @@
+#ifndef RIGID_BODY_H
+#define RIGID_BODY_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cmath>
+#include "wide_bvh.hpp"
+
+#define BODY_DEFAULT_ANGULAR_DAMPING 0.99f  // por frame de 60 Hz
+#define BODY_REFERENCE_RATE 60.0f           // taxa em que angularDamping foi ajustado
+
+// Estado de todos os corpos rígidos em arrays separados por componente (SoA):
+// a integração percorre cada array em sequência, 4 ou 8 corpos por instrução.
+// Orientação em quaternion; velocidade angular em graus por segundo.
+struct RigidBodyWorld {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> orientationX, orientationY, orientationZ, orientationW;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> angularX, angularY, angularZ;
+    std::vector<float> mass, inverseMass;
+    std::vector<float> angularDamping;      // por frame de 60 Hz
+    std::vector<float> angularDampingStep;  // convertido para o passo atual
+    std::vector<unsigned char> asleep;      // fora da integração até acordar
+
+    int add(const glm::vec3& position, const glm::quat& orientation, float bodyMass);
+    int size() const { return (int)mass.size(); }
+    void setStep(float dt);
+
+    glm::vec3 position(int i) const { return glm::vec3(positionX[i], positionY[i], positionZ[i]); }
+    glm::quat orientation(int i) const { return glm::quat(orientationW[i], orientationX[i], orientationY[i], orientationZ[i]); }
+    glm::vec3 velocity(int i) const { return glm::vec3(velocityX[i], velocityY[i], velocityZ[i]); }
+    glm::vec3 angularVelocity(int i) const { return glm::vec3(angularX[i], angularY[i], angularZ[i]); }
+
+    void setPosition(int i, const glm::vec3& p);
+    void setOrientation(int i, const glm::quat& q);
+    void setVelocity(int i, const glm::vec3& v);
+    void setAngularVelocity(int i, const glm::vec3& w);
+
+    bool sleeping(int i) const { return asleep[i] != 0; }
+    void sleep(int i);
+    void wake(int i) { asleep[i] = 0; }
+    int awakeCount() const;
+
+private:
+    float step = 0.0f;
+};
+
+int RigidBodyWorld::add(const glm::vec3& position, const glm::quat& orientation, float bodyMass) {
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    orientationX.push_back(orientation.x);
+    orientationY.push_back(orientation.y);
+    orientationZ.push_back(orientation.z);
+    orientationW.push_back(orientation.w);
+    velocityX.push_back(0.0f);
+    velocityY.push_back(0.0f);
+    velocityZ.push_back(0.0f);
+    angularX.push_back(0.0f);
+    angularY.push_back(0.0f);
+    angularZ.push_back(0.0f);
+    mass.push_back(bodyMass);
+    inverseMass.push_back(bodyMass > 0.0f ? 1.0f / bodyMass : 0.0f);
+    angularDamping.push_back(BODY_DEFAULT_ANGULAR_DAMPING);
+    angularDampingStep.push_back(std::pow(BODY_DEFAULT_ANGULAR_DAMPING, step * BODY_REFERENCE_RATE));
+    asleep.push_back(0);
+    return size() - 1;
+}
+
+// pow só quando o passo muda, fora do laço de integração
+void RigidBodyWorld::setStep(float dt) {
+    if (dt == step) return;
+    step = dt;
+    for (int i = 0; i < size(); i++)
+        angularDampingStep[i] = std::pow(angularDamping[i], dt * BODY_REFERENCE_RATE);
+}
+
+void RigidBodyWorld::setPosition(int i, const glm::vec3& p) {
+    positionX[i] = p.x;
+    positionY[i] = p.y;
+    positionZ[i] = p.z;
+}
+
+void RigidBodyWorld::setOrientation(int i, const glm::quat& q) {
+    orientationX[i] = q.x;
+    orientationY[i] = q.y;
+    orientationZ[i] = q.z;
+    orientationW[i] = q.w;
+}
+
+void RigidBodyWorld::setVelocity(int i, const glm::vec3& v) {
+    velocityX[i] = v.x;
+    velocityY[i] = v.y;
+    velocityZ[i] = v.z;
+}
+
+void RigidBodyWorld::setAngularVelocity(int i, const glm::vec3& w) {
+    angularX[i] = w.x;
+    angularY[i] = w.y;
+    angularZ[i] = w.z;
+}
+
+// Dorme parado: velocidades zeradas, para não voltar com a energia de antes
+void RigidBodyWorld::sleep(int i) {
+    asleep[i] = 1;
+    setVelocity(i, glm::vec3(0.0f));
+    setAngularVelocity(i, glm::vec3(0.0f));
+}
+
+int RigidBodyWorld::awakeCount() const {
+    int count = 0;
+    for (unsigned char s : asleep)
+        count += !s;
+    return count;
+}
+
+// Referência de um Model ao seu corpo no mundo
+struct BodyHandle {
+    RigidBodyWorld* world = nullptr;
+    int index = -1;
+
+    bool valid() const { return world != nullptr; }
+    float mass() const { return world->mass[index]; }
+    float inverseMass() const { return world->inverseMass[index]; }
+    glm::vec3 velocity() const { return world->velocity(index); }
+    glm::vec3 angularVelocity() const { return world->angularVelocity(index); }
+    void setVelocity(const glm::vec3& v) const { world->setVelocity(index, v); }
+    void setAngularVelocity(const glm::vec3& w) const { world->setAngularVelocity(index, w); }
+    bool sleeping() const { return world->sleeping(index); }
+    void wake() const { world->wake(index); }
+};
+
+// Entradas de um passo: aceleração comum a todos os corpos (gravidade e
+// tremor) e o giro do tremor por corpo, em graus por frame de 60 Hz.
+// O giro é em torno do eixo Y local, como Model::rotate; a velocidade
+// angular do corpo gira em torno do eixo dela no mundo.
+struct BodyStepInput {
+    glm::vec3 acceleration = glm::vec3(0.0f);
+    float dt = 0.0f;
+    const float* spin = nullptr;  // world.size() valores
+    float spinScale = 1.0f;       // frames de 60 Hz por passo
+    float torqueScale = 0.0f;     // ganho de velocidade angular por grau de giro e por unidade de massa
+    float linearDamping = 1.0f;   // fator por passo
+    float linearRest = 0.0f;      // velocidades abaixo disso zeram
+    float angularRest = 0.0f;     // graus por segundo
+};
+
+#define BODY_HALF_RADIANS (glm::pi<float>() / 360.0f)  // graus -> meio ângulo em radianos
+
+// Um corpo por vez; também cobre a sobra dos kernels SIMD.
+// Rotação de primeira ordem, renormalizada: q += q * (0, 0, s, 0) para o
+// giro do tremor no Y local e q += (0, w * dt / 2) * q para a velocidade
+// angular, que está no mundo.
+void integrateBodiesScalar(RigidBodyWorld& world, const BodyStepInput& in, int begin, int end) {
+    float halfStep = in.dt * BODY_HALF_RADIANS;
+    for (int i = begin; i < end; i++) {
+        float vx = world.velocityX[i] + in.acceleration.x * in.dt;
+        float vy = world.velocityY[i] + in.acceleration.y * in.dt;
+        float vz = world.velocityZ[i] + in.acceleration.z * in.dt;
+        world.positionX[i] += vx * in.dt;
+        world.positionY[i] += vy * in.dt;
+        world.positionZ[i] += vz * in.dt;
+
+        float damp = world.angularDampingStep[i];
+        float wx = world.angularX[i] * damp;
+        float wy = (world.angularY[i] + in.spin[i] * world.mass[i] * in.torqueScale) * damp;
+        float wz = world.angularZ[i] * damp;
+
+        float s = in.spin[i] * in.spinScale * BODY_HALF_RADIANS;
+        float hx = wx * halfStep, hy = wy * halfStep, hz = wz * halfStep;
+        float qx = world.orientationX[i], qy = world.orientationY[i], qz = world.orientationZ[i], qw = world.orientationW[i];
+        float nx = qx - qz * s + qw * hx + hy * qz - hz * qy;
+        float ny = qy + qw * s + qw * hy + hz * qx - hx * qz;
+        float nz = qz + qx * s + qw * hz + hx * qy - hy * qx;
+        float nw = qw - qy * s - hx * qx - hy * qy - hz * qz;
+        float inv = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+        world.orientationX[i] = nx * inv;
+        world.orientationY[i] = ny * inv;
+        world.orientationZ[i] = nz * inv;
+        world.orientationW[i] = nw * inv;
+
+        // atrito: zera abaixo do repouso, senão amortece
+        float linear = vx * vx + vy * vy + vz * vz >= in.linearRest * in.linearRest ? in.linearDamping : 0.0f;
+        world.velocityX[i] = vx * linear;
+        world.velocityY[i] = vy * linear;
+        world.velocityZ[i] = vz * linear;
+
+        float angular = wx * wx + wy * wy + wz * wz >= in.angularRest * in.angularRest ? damp : 0.0f;
+        world.angularX[i] = wx * angular;
+        world.angularY[i] = wy * angular;
+        world.angularZ[i] = wz * angular;
+    }
+}
+
+#ifdef WIDE_BVH_X86
+// Quatro corpos por iteração a partir de begin; devolve onde parou
+int integrateBodiesSse(RigidBodyWorld& world, const BodyStepInput& in, int begin, int end) {
+    const __m128 dt = _mm_set1_ps(in.dt);
+    const __m128 ax = _mm_set1_ps(in.acceleration.x), ay = _mm_set1_ps(in.acceleration.y), az = _mm_set1_ps(in.acceleration.z);
+    const __m128 spinScale = _mm_set1_ps(in.spinScale), torqueScale = _mm_set1_ps(in.torqueScale);
+    const __m128 halfRadians = _mm_set1_ps(BODY_HALF_RADIANS), one = _mm_set1_ps(1.0f);
+    const __m128 halfStep = _mm_set1_ps(in.dt * BODY_HALF_RADIANS);
+    const __m128 linearDamping = _mm_set1_ps(in.linearDamping);
+    const __m128 linearRest2 = _mm_set1_ps(in.linearRest * in.linearRest), angularRest2 = _mm_set1_ps(in.angularRest * in.angularRest);
+
+    int count = begin + ((end - begin) & ~3);
+    for (int i = begin; i < count; i += 4) {
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(&world.velocityX[i]), _mm_mul_ps(ax, dt));
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(&world.velocityY[i]), _mm_mul_ps(ay, dt));
+        __m128 vz = _mm_add_ps(_mm_loadu_ps(&world.velocityZ[i]), _mm_mul_ps(az, dt));
+        _mm_storeu_ps(&world.positionX[i], _mm_add_ps(_mm_loadu_ps(&world.positionX[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&world.positionY[i], _mm_add_ps(_mm_loadu_ps(&world.positionY[i]), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(&world.positionZ[i], _mm_add_ps(_mm_loadu_ps(&world.positionZ[i]), _mm_mul_ps(vz, dt)));
+
+        __m128 spin = _mm_loadu_ps(in.spin + i);
+        __m128 damp = _mm_loadu_ps(&world.angularDampingStep[i]);
+        __m128 wx = _mm_mul_ps(_mm_loadu_ps(&world.angularX[i]), damp);
+        __m128 wy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&world.angularY[i]), _mm_mul_ps(_mm_mul_ps(spin, _mm_loadu_ps(&world.mass[i])), torqueScale)), damp);
+        __m128 wz = _mm_mul_ps(_mm_loadu_ps(&world.angularZ[i]), damp);
+
+        __m128 s = _mm_mul_ps(_mm_mul_ps(spin, spinScale), halfRadians);
+        __m128 hx = _mm_mul_ps(wx, halfStep), hy = _mm_mul_ps(wy, halfStep), hz = _mm_mul_ps(wz, halfStep);
+        __m128 qx = _mm_loadu_ps(&world.orientationX[i]), qy = _mm_loadu_ps(&world.orientationY[i]);
+        __m128 qz = _mm_loadu_ps(&world.orientationZ[i]), qw = _mm_loadu_ps(&world.orientationW[i]);
+        __m128 nx = _mm_add_ps(_mm_sub_ps(qx, _mm_mul_ps(qz, s)), _mm_add_ps(_mm_mul_ps(qw, hx), _mm_sub_ps(_mm_mul_ps(hy, qz), _mm_mul_ps(hz, qy))));
+        __m128 ny = _mm_add_ps(_mm_add_ps(qy, _mm_mul_ps(qw, s)), _mm_add_ps(_mm_mul_ps(qw, hy), _mm_sub_ps(_mm_mul_ps(hz, qx), _mm_mul_ps(hx, qz))));
+        __m128 nz = _mm_add_ps(_mm_add_ps(qz, _mm_mul_ps(qx, s)), _mm_add_ps(_mm_mul_ps(qw, hz), _mm_sub_ps(_mm_mul_ps(hx, qy), _mm_mul_ps(hy, qx))));
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, qx), _mm_mul_ps(hy, qy)), _mm_mul_ps(hz, qz));
+        __m128 nw = _mm_sub_ps(_mm_sub_ps(qw, _mm_mul_ps(qy, s)), dot);
+        __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_add_ps(_mm_mul_ps(nz, nz), _mm_mul_ps(nw, nw)));
+        __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(length2));
+        _mm_storeu_ps(&world.orientationX[i], _mm_mul_ps(nx, inv));
+        _mm_storeu_ps(&world.orientationY[i], _mm_mul_ps(ny, inv));
+        _mm_storeu_ps(&world.orientationZ[i], _mm_mul_ps(nz, inv));
+        _mm_storeu_ps(&world.orientationW[i], _mm_mul_ps(nw, inv));
+
+        __m128 speed2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        __m128 linear = _mm_and_ps(_mm_cmpge_ps(speed2, linearRest2), linearDamping);
+        _mm_storeu_ps(&world.velocityX[i], _mm_mul_ps(vx, linear));
+        _mm_storeu_ps(&world.velocityY[i], _mm_mul_ps(vy, linear));
+        _mm_storeu_ps(&world.velocityZ[i], _mm_mul_ps(vz, linear));
+
+        __m128 spin2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy)), _mm_mul_ps(wz, wz));
+        __m128 angular = _mm_and_ps(_mm_cmpge_ps(spin2, angularRest2), damp);
+        _mm_storeu_ps(&world.angularX[i], _mm_mul_ps(wx, angular));
+        _mm_storeu_ps(&world.angularY[i], _mm_mul_ps(wy, angular));
+        _mm_storeu_ps(&world.angularZ[i], _mm_mul_ps(wz, angular));
+    }
+    return count;
+}
+
+// Oito corpos por iteração a partir de begin; devolve onde parou
+__attribute__((target("avx2")))
+int integrateBodiesAvx2(RigidBodyWorld& world, const BodyStepInput& in, int begin, int end) {
+    const __m256 dt = _mm256_set1_ps(in.dt);
+    const __m256 ax = _mm256_set1_ps(in.acceleration.x), ay = _mm256_set1_ps(in.acceleration.y), az = _mm256_set1_ps(in.acceleration.z);
+    const __m256 spinScale = _mm256_set1_ps(in.spinScale), torqueScale = _mm256_set1_ps(in.torqueScale);
+    const __m256 halfRadians = _mm256_set1_ps(BODY_HALF_RADIANS), one = _mm256_set1_ps(1.0f);
+    const __m256 halfStep = _mm256_set1_ps(in.dt * BODY_HALF_RADIANS);
+    const __m256 linearDamping = _mm256_set1_ps(in.linearDamping);
+    const __m256 linearRest2 = _mm256_set1_ps(in.linearRest * in.linearRest), angularRest2 = _mm256_set1_ps(in.angularRest * in.angularRest);
+
+    int count = begin + ((end - begin) & ~7);
+    for (int i = begin; i < count; i += 8) {
+        __m256 vx = _mm256_add_ps(_mm256_loadu_ps(&world.velocityX[i]), _mm256_mul_ps(ax, dt));
+        __m256 vy = _mm256_add_ps(_mm256_loadu_ps(&world.velocityY[i]), _mm256_mul_ps(ay, dt));
+        __m256 vz = _mm256_add_ps(_mm256_loadu_ps(&world.velocityZ[i]), _mm256_mul_ps(az, dt));
+        _mm256_storeu_ps(&world.positionX[i], _mm256_add_ps(_mm256_loadu_ps(&world.positionX[i]), _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(&world.positionY[i], _mm256_add_ps(_mm256_loadu_ps(&world.positionY[i]), _mm256_mul_ps(vy, dt)));
+        _mm256_storeu_ps(&world.positionZ[i], _mm256_add_ps(_mm256_loadu_ps(&world.positionZ[i]), _mm256_mul_ps(vz, dt)));
+
+        __m256 spin = _mm256_loadu_ps(in.spin + i);
+        __m256 damp = _mm256_loadu_ps(&world.angularDampingStep[i]);
+        __m256 wx = _mm256_mul_ps(_mm256_loadu_ps(&world.angularX[i]), damp);
+        __m256 wy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&world.angularY[i]), _mm256_mul_ps(_mm256_mul_ps(spin, _mm256_loadu_ps(&world.mass[i])), torqueScale)), damp);
+        __m256 wz = _mm256_mul_ps(_mm256_loadu_ps(&world.angularZ[i]), damp);
+
+        __m256 s = _mm256_mul_ps(_mm256_mul_ps(spin, spinScale), halfRadians);
+        __m256 hx = _mm256_mul_ps(wx, halfStep), hy = _mm256_mul_ps(wy, halfStep), hz = _mm256_mul_ps(wz, halfStep);
+        __m256 qx = _mm256_loadu_ps(&world.orientationX[i]), qy = _mm256_loadu_ps(&world.orientationY[i]);
+        __m256 qz = _mm256_loadu_ps(&world.orientationZ[i]), qw = _mm256_loadu_ps(&world.orientationW[i]);
+        __m256 nx = _mm256_add_ps(_mm256_sub_ps(qx, _mm256_mul_ps(qz, s)), _mm256_add_ps(_mm256_mul_ps(qw, hx), _mm256_sub_ps(_mm256_mul_ps(hy, qz), _mm256_mul_ps(hz, qy))));
+        __m256 ny = _mm256_add_ps(_mm256_add_ps(qy, _mm256_mul_ps(qw, s)), _mm256_add_ps(_mm256_mul_ps(qw, hy), _mm256_sub_ps(_mm256_mul_ps(hz, qx), _mm256_mul_ps(hx, qz))));
+        __m256 nz = _mm256_add_ps(_mm256_add_ps(qz, _mm256_mul_ps(qx, s)), _mm256_add_ps(_mm256_mul_ps(qw, hz), _mm256_sub_ps(_mm256_mul_ps(hx, qy), _mm256_mul_ps(hy, qx))));
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(hx, qx), _mm256_mul_ps(hy, qy)), _mm256_mul_ps(hz, qz));
+        __m256 nw = _mm256_sub_ps(_mm256_sub_ps(qw, _mm256_mul_ps(qy, s)), dot);
+        __m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_add_ps(_mm256_mul_ps(nz, nz), _mm256_mul_ps(nw, nw)));
+        __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(length2));
+        _mm256_storeu_ps(&world.orientationX[i], _mm256_mul_ps(nx, inv));
+        _mm256_storeu_ps(&world.orientationY[i], _mm256_mul_ps(ny, inv));
+        _mm256_storeu_ps(&world.orientationZ[i], _mm256_mul_ps(nz, inv));
+        _mm256_storeu_ps(&world.orientationW[i], _mm256_mul_ps(nw, inv));
+
+        __m256 speed2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+        __m256 linear = _mm256_and_ps(_mm256_cmp_ps(speed2, linearRest2, _CMP_GE_OQ), linearDamping);
+        _mm256_storeu_ps(&world.velocityX[i], _mm256_mul_ps(vx, linear));
+        _mm256_storeu_ps(&world.velocityY[i], _mm256_mul_ps(vy, linear));
+        _mm256_storeu_ps(&world.velocityZ[i], _mm256_mul_ps(vz, linear));
+
+        __m256 spin2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wx, wx), _mm256_mul_ps(wy, wy)), _mm256_mul_ps(wz, wz));
+        __m256 angular = _mm256_and_ps(_mm256_cmp_ps(spin2, angularRest2, _CMP_GE_OQ), damp);
+        _mm256_storeu_ps(&world.angularX[i], _mm256_mul_ps(wx, angular));
+        _mm256_storeu_ps(&world.angularY[i], _mm256_mul_ps(wy, angular));
+        _mm256_storeu_ps(&world.angularZ[i], _mm256_mul_ps(wz, angular));
+    }
+    return count;
+}
+#endif
+
+// Gravidade, tremor, giro e amortecimento dos corpos acordados num passo.
+// Os kernels rodam sobre cada sequência contígua de corpos acordados.
+void integrateBodies(RigidBodyWorld& world, const BodyStepInput& in, SimdLevel level = detectSimdLevel()) {
+    world.setStep(in.dt);
+
+    int begin = 0;
+    while (begin < world.size()) {
+        if (world.asleep[begin]) {
+            begin++;
+            continue;
+        }
+        int end = begin;
+        while (end < world.size() && !world.asleep[end])
+            end++;
+
+        int done = begin;
+#ifdef WIDE_BVH_X86
+        if (level == SIMD_AVX2)
+            done = integrateBodiesAvx2(world, in, begin, end);
+        else if (level == SIMD_SSE)
+            done = integrateBodiesSse(world, in, begin, end);
+#endif
+        integrateBodiesScalar(world, in, done, end);
+        begin = end;
+    }
+}
+
+#endif
@@ -0,0 +1,453 @@
+#ifndef SDF_H
+#define SDF_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "model.hpp"
+#include "contact.hpp"
+#include "thread_pool.hpp"
+
+#define SDF_CELLS 64                // células no maior eixo da malha
+#define SDF_BRICK 8                 // células por lado de um bloco
+#define SDF_BAND_CELLS 4            // largura da faixa estreita em volta da superfície, em células
+#define SDF_BRICK_SAMPLES ((SDF_BRICK + 1) * (SDF_BRICK + 1) * (SDF_BRICK + 1))
+#define SDF_CACHE_MAGIC 0x30464453  // "SDF0"
+#define SDF_CACHE_VERSION 1
+#define SDF_NORMAL_GROUP 0.9f       // cosseno mínimo entre normais do mesmo contato com a cena
+#define SDF_MAX_GROUPS 4            // contatos com a cena por corpo (chão e até três paredes)
+
+// Distância com sinal de uma malha estática, no espaço do modelo: positiva
+// do lado para onde apontam os triângulos. A grade é esparsa, em blocos de
+// SDF_BRICK³ células: só os blocos que a faixa de SDF_BAND_CELLS células em
+// volta da superfície alcança guardam os (SDF_BRICK+1)³ cantos; os outros
+// guardam só uma cota inferior, a distância do centro menos meia diagonal,
+// que basta para o sinal e um gradiente grosso. Com solidOutside o que fica
+// fora da grade conta como sólido: a sala contém a cena, e a frente aberta
+// dela não deixa corpo escapar.
+struct SignedDistanceField {
+    glm::vec3 origin = glm::vec3(0.0f);
+    float cellSize = 0.0f;
+    glm::ivec3 bricks = glm::ivec3(0);
+    std::vector<float> coarse;          // por bloco: cota inferior da distância, com sinal
+    std::vector<int32_t> brickSamples;  // por bloco: primeiro canto em samples / SDF_BRICK_SAMPLES, -1 fora da faixa
+    std::vector<float> samples;
+    uint64_t fingerprint = 0;           // das malhas de origem, para validar o cache
+    bool solidOutside = false;
+
+    bool empty() const { return coarse.empty(); }
+    int fineBricks() const { return (int)(samples.size() / SDF_BRICK_SAMPLES); }
+    float distance(const glm::vec3& p, glm::vec3* gradient = nullptr) const;
+    float boundaryDistance(const glm::vec3& p) const;
+
+private:
+    glm::vec3 centralGradient(const glm::vec3& p) const;
+};
+
+// Trilinear dentro do bloco, e o gradiente unitário dela se pedido; fora da
+// faixa, a cota do bloco
+float SignedDistanceField::distance(const glm::vec3& p, glm::vec3* gradient) const {
+    glm::vec3 g = (p - origin) / cellSize;
+    glm::vec3 limit = glm::vec3(bricks * SDF_BRICK);
+    glm::vec3 inside = glm::clamp(g, glm::vec3(0.0f), limit);
+    if (inside != g) {
+        float outside = glm::length(g - inside) * cellSize;
+        if (gradient) *gradient = centralGradient(p);
+        // a grade cobre a faixa em volta da malha: fora dela o livre está a mais que isso
+        return solidOutside ? -outside : SDF_BAND_CELLS * cellSize + outside;
+    }
+
+    glm::ivec3 cell = glm::min(glm::ivec3(glm::floor(g)), bricks * SDF_BRICK - 1);
+    glm::ivec3 brick = cell / SDF_BRICK;
+    int index = (brick.z * bricks.y + brick.y) * bricks.x + brick.x;
+    if (brickSamples[index] < 0) {
+        if (gradient) *gradient = centralGradient(p);
+        return coarse[index];
+    }
+
+    const float* corners = samples.data() + (size_t)brickSamples[index] * SDF_BRICK_SAMPLES;
+    glm::ivec3 local = cell - brick * SDF_BRICK;
+    glm::vec3 f = g - glm::vec3(cell);
+    auto at = [&](int x, int y, int z) {
+        return corners[((local.z + z) * (SDF_BRICK + 1) + local.y + y) * (SDF_BRICK + 1) + local.x + x];
+    };
+    float x00 = at(0, 0, 0) + (at(1, 0, 0) - at(0, 0, 0)) * f.x;
+    float x10 = at(0, 1, 0) + (at(1, 1, 0) - at(0, 1, 0)) * f.x;
+    float x01 = at(0, 0, 1) + (at(1, 0, 1) - at(0, 0, 1)) * f.x;
+    float x11 = at(0, 1, 1) + (at(1, 1, 1) - at(0, 1, 1)) * f.x;
+    float y0 = x00 + (x10 - x00) * f.y;
+    float y1 = x01 + (x11 - x01) * f.y;
+
+    if (gradient) {
+        float dx0 = (at(1, 0, 0) - at(0, 0, 0)) + ((at(1, 1, 0) - at(0, 1, 0)) - (at(1, 0, 0) - at(0, 0, 0))) * f.y;
+        float dx1 = (at(1, 0, 1) - at(0, 0, 1)) + ((at(1, 1, 1) - at(0, 1, 1)) - (at(1, 0, 1) - at(0, 0, 1))) * f.y;
+        glm::vec3 d(dx0 + (dx1 - dx0) * f.z, (x10 - x00) + ((x11 - x01) - (x10 - x00)) * f.z, y1 - y0);
+        *gradient = glm::dot(d, d) > 1e-12f ? glm::normalize(d) : centralGradient(p);
+    }
+    return y0 + (y1 - y0) * f.z;
+}
+
+// Distância de p às faces da grade, negativa fora dela
+float SignedDistanceField::boundaryDistance(const glm::vec3& p) const {
+    glm::vec3 low = p - origin;
+    glm::vec3 high = origin + glm::vec3(bricks * SDF_BRICK) * cellSize - p;
+    glm::vec3 nearest = glm::min(low, high);
+    return glm::min(nearest.x, glm::min(nearest.y, nearest.z));
+}
+
+// Diferenças centrais, unitário; onde o campo é plano na escala da célula
+// (blocos grossos) tenta na escala do bloco
+glm::vec3 SignedDistanceField::centralGradient(const glm::vec3& p) const {
+    for (float h : {0.5f * cellSize, (float)SDF_BRICK * cellSize}) {
+        glm::vec3 g(distance(p + glm::vec3(h, 0.0f, 0.0f)) - distance(p - glm::vec3(h, 0.0f, 0.0f)),
+                    distance(p + glm::vec3(0.0f, h, 0.0f)) - distance(p - glm::vec3(0.0f, h, 0.0f)),
+                    distance(p + glm::vec3(0.0f, 0.0f, h)) - distance(p - glm::vec3(0.0f, 0.0f, h)));
+        if (glm::dot(g, g) > 1e-12f) return glm::normalize(g);
+    }
+    return glm::vec3(0.0f);
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5
+static glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Distância com sinal de p às malhas pelo triângulo mais próximo, descendo
+// as BVHs com poda pela distância às caixas. Nos empates (p diante de uma
+// aresta ou de um canto) vale o triângulo que p vê mais de frente, o que
+// acerta o sinal nas quinas da sala.
+static float meshSignedDistance(const std::vector<Mesh>& meshes, const glm::vec3& p) {
+    float bestSquared = FLT_MAX;
+    float bestFacing = -1.0f;
+    float sign = 1.0f;
+
+    for (const Mesh& mesh : meshes) {
+        const std::vector<BVHNode>& nodes = mesh.boundingTree;
+        if (nodes.empty()) continue;
+
+        GLuint stack[BVH_MAX_DEPTH + 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            GLuint index = stack[--top];
+            const BVHNode& node = nodes[index];
+            glm::vec3 outside = glm::max(glm::max(node.min_corner - p, p - node.max_corner), glm::vec3(0.0f));
+            if (glm::dot(outside, outside) > bestSquared * 1.0001f) continue;
+
+            if (!node.isLeaf()) {
+                stack[top++] = node.offset;
+                stack[top++] = index + 1;
+                continue;
+            }
+
+            for (GLuint t = node.offset; t < node.offset + node.triangleCount; t++) {
+                const glm::vec3& a = mesh.vertices[mesh.indices[3 * t]].position;
+                const glm::vec3& b = mesh.vertices[mesh.indices[3 * t + 1]].position;
+                const glm::vec3& c = mesh.vertices[mesh.indices[3 * t + 2]].position;
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float area = glm::length(normal);
+                if (area <= 0.0f) continue;
+                normal /= area;
+
+                glm::vec3 offset = p - closestPointOnTriangle(p, a, b, c);
+                float squared = glm::dot(offset, offset);
+                float along = glm::dot(offset, normal);
+                float facing = squared > 0.0f ? std::abs(along) / std::sqrt(squared) : 1.0f;
+
+                bool closer = squared < bestSquared * 0.9999f;
+                bool tied = !closer && squared <= bestSquared * 1.0001f && facing > bestFacing;
+                if (!closer && !tied) continue;
+                bestSquared = glm::min(bestSquared, squared);
+                bestFacing = facing;
+                sign = along >= 0.0f ? 1.0f : -1.0f;
+            }
+        }
+    }
+    return bestSquared == FLT_MAX ? FLT_MAX : sign * std::sqrt(bestSquared);
+}
+
+static uint64_t sdfFingerprint(const std::vector<Mesh>& meshes) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const Mesh& mesh : meshes)
+        hash = (hash ^ meshFingerprint(mesh.vertices)) * 1099511628211ull;
+    return hash;
+}
+
+// Grade que cobre a caixa das malhas mais a faixa; false se não tem volume
+static bool sdfGrid(const std::vector<Mesh>& meshes, glm::vec3& origin, float& cellSize, glm::ivec3& bricks) {
+    AABB box = emptyAABB();
+    for (const Mesh& mesh : meshes)
+        for (const Vertex& vertex : mesh.vertices) {
+            box.min_corner = glm::min(box.min_corner, vertex.position);
+            box.max_corner = glm::max(box.max_corner, vertex.position);
+        }
+    glm::vec3 size = box.max_corner - box.min_corner;
+    float longest = glm::max(size.x, glm::max(size.y, size.z));
+    if (!(longest > 0.0f)) return false;
+
+    cellSize = longest / SDF_CELLS;
+    float band = SDF_BAND_CELLS * cellSize;
+    origin = box.min_corner - glm::vec3(band);
+    bricks = glm::ivec3(glm::ceil((size + 2.0f * band) / (SDF_BRICK * cellSize)));
+    return true;
+}
+
+// Primeiro os centros de todos os blocos, depois os cantos dos que a faixa
+// alcança, os dois em paralelo no pool
+SignedDistanceField buildSignedDistanceField(const std::vector<Mesh>& meshes, int threads) {
+    PROFILE_FUNCTION();
+    SignedDistanceField field;
+    field.fingerprint = sdfFingerprint(meshes);
+    if (!sdfGrid(meshes, field.origin, field.cellSize, field.bricks)) return field;
+
+    float band = SDF_BAND_CELLS * field.cellSize;
+    float brickSize = SDF_BRICK * field.cellSize;
+    int count = field.bricks.x * field.bricks.y * field.bricks.z;
+    field.coarse.assign(count, 0.0f);
+    field.brickSamples.assign(count, -1);
+
+    auto brickOrigin = [&](int i) {
+        glm::ivec3 brick(i % field.bricks.x, (i / field.bricks.x) % field.bricks.y, i / (field.bricks.x * field.bricks.y));
+        return field.origin + glm::vec3(brick) * brickSize;
+    };
+
+    WorkStealingPool pool(threads);
+    pool.parallelFor(count, [&](int i, int) {
+        field.coarse[i] = meshSignedDistance(meshes, brickOrigin(i) + glm::vec3(0.5f * brickSize));
+    });
+
+    std::vector<int> fine;
+    float halfDiagonal = 0.5f * std::sqrt(3.0f) * brickSize;
+    float reach = halfDiagonal + band;
+    for (int i = 0; i < count; i++) {
+        if (std::abs(field.coarse[i]) > reach) {
+            field.coarse[i] -= std::copysign(halfDiagonal, field.coarse[i]);
+            continue;
+        }
+        field.brickSamples[i] = (int32_t)fine.size();
+        fine.push_back(i);
+    }
+
+    field.samples.resize(fine.size() * SDF_BRICK_SAMPLES);
+    pool.parallelFor((int)fine.size(), [&](int k, int) {
+        glm::vec3 corner = brickOrigin(fine[k]);
+        float* out = field.samples.data() + (size_t)k * SDF_BRICK_SAMPLES;
+        for (int z = 0; z <= SDF_BRICK; z++)
+            for (int y = 0; y <= SDF_BRICK; y++)
+                for (int x = 0; x <= SDF_BRICK; x++)
+                    *out++ = meshSignedDistance(meshes, corner + glm::vec3(x, y, z) * field.cellSize);
+    });
+    return field;
+}
+
+// Cache binário ao lado do .obj; false se faltar, for de outra versão, de
+// outros parâmetros de grade ou de outra malha, ou se a grade e os índices
+// dos blocos não baterem com o que buildSignedDistanceField geraria
+bool loadSignedDistanceField(const std::string& path, const std::vector<Mesh>& meshes, SignedDistanceField& field) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    uint32_t header[5] = {0, 0, 0, 0, 0};
+    file.read((char*)header, sizeof(header));
+    file.read((char*)&field.fingerprint, sizeof(field.fingerprint));
+    if (!file || header[0] != SDF_CACHE_MAGIC || header[1] != SDF_CACHE_VERSION || header[2] != SDF_CELLS
+        || header[3] != SDF_BRICK || header[4] != SDF_BAND_CELLS || field.fingerprint != sdfFingerprint(meshes))
+        return false;
+
+    glm::vec3 origin;
+    float cellSize;
+    glm::ivec3 bricks;
+    if (!sdfGrid(meshes, origin, cellSize, bricks)) return false;
+
+    uint64_t sampleCount = 0;
+    file.read((char*)&field.origin, sizeof(field.origin));
+    file.read((char*)&field.cellSize, sizeof(field.cellSize));
+    file.read((char*)&field.bricks, sizeof(field.bricks));
+    file.read((char*)&sampleCount, sizeof(sampleCount));
+    if (!file || field.origin != origin || field.cellSize != cellSize || field.bricks != bricks)
+        return false;
+
+    size_t count = (size_t)bricks.x * bricks.y * bricks.z;
+    field.coarse.resize(count);
+    field.brickSamples.resize(count);
+    file.read((char*)field.coarse.data(), count * sizeof(float));
+    file.read((char*)field.brickSamples.data(), count * sizeof(int32_t));
+    if (!file) return false;
+
+    // os blocos na faixa são numerados em ordem, e cada um tem os seus cantos
+    uint64_t fine = 0;
+    for (int32_t index : field.brickSamples) {
+        if (index == -1) continue;
+        if (index != (int64_t)fine) return false;
+        fine++;
+    }
+    if (sampleCount != fine * SDF_BRICK_SAMPLES) return false;
+
+    field.samples.resize(sampleCount);
+    file.read((char*)field.samples.data(), sampleCount * sizeof(float));
+    return (bool)file;
+}
+
+void saveSignedDistanceField(const std::string& path, const SignedDistanceField& field) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Erro ao escrever cache do campo de distância: " << path << std::endl;
+        return;
+    }
+
+    uint32_t header[5] = {SDF_CACHE_MAGIC, SDF_CACHE_VERSION, SDF_CELLS, SDF_BRICK, SDF_BAND_CELLS};
+    uint64_t sampleCount = field.samples.size();
+    file.write((const char*)header, sizeof(header));
+    file.write((const char*)&field.fingerprint, sizeof(field.fingerprint));
+    file.write((const char*)&field.origin, sizeof(field.origin));
+    file.write((const char*)&field.cellSize, sizeof(field.cellSize));
+    file.write((const char*)&field.bricks, sizeof(field.bricks));
+    file.write((const char*)&sampleCount, sizeof(sampleCount));
+    file.write((const char*)field.coarse.data(), field.coarse.size() * sizeof(float));
+    file.write((const char*)field.brickSamples.data(), field.brickSamples.size() * sizeof(int32_t));
+    file.write((const char*)field.samples.data(), field.samples.size() * sizeof(float));
+}
+
+// data/<nome>/source/model.sdf
+SignedDistanceField loadOrBuildSignedDistanceField(const std::string& modelFile, const std::vector<Mesh>& meshes, int threads) {
+    PROFILE_FUNCTION();
+    std::string path = std::filesystem::path(modelFile).replace_extension(".sdf").string();
+
+    SignedDistanceField field;
+    if (loadSignedDistanceField(path, meshes, field))
+        return field;
+
+    field = buildSignedDistanceField(meshes, threads);
+    if (!field.empty())
+        saveSignedDistanceField(path, field);
+    return field;
+}
+
+// Contato de um corpo com a geometria estática; normal da cena para o corpo
+struct SceneContact {
+    int model;
+    ContactManifold manifold;
+};
+
+// Os vértices dos hulls de cada corpo acordado (os cantos da caixa, sem
+// hull) vão para o espaço do campo; os que caem com distância negativa são
+// pontos de contato. Normal e profundidade vêm do gradiente e passam para o
+// mundo pela inversa transposta da matriz do campo, exato para os planos.
+// Os pontos são agrupados pela normal e cada grupo vira um contato: um corpo
+// no canto entre o chão e a parede tem um contato com cada, em vez de uma
+// normal média inclinada.
+// A distância lida nunca passa da real por mais que uma célula, então um
+// hull cujo centro está mais longe da superfície que o raio dele é pulado
+// sem ler os vértices.
+void sceneFieldContacts(const SignedDistanceField& field, const glm::mat4& fieldMatrix, const std::vector<Model>& models, std::vector<SceneContact>& contacts) {
+    PROFILE_FUNCTION();
+    contacts.clear();
+    if (field.empty()) return;
+
+    glm::mat4 toField = glm::inverse(fieldMatrix);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(fieldMatrix)));
+    float margin = field.cellSize;  // erro da trilinear
+    std::vector<ContactPoint> points;
+    std::vector<ContactPoint> groups[SDF_MAX_GROUPS];
+
+    for (int i = 0; i < (int)models.size(); i++) {
+        const Model& model = models[i];
+        if (model.body.sleeping()) continue;
+
+        glm::mat4 modelToField = toField * model.effect * model.modelMatrix();
+        points.clear();
+        auto sample = [&](const glm::vec3& p) {
+            glm::vec3 gradient;
+            float d = field.distance(p, &gradient);
+            if (d >= 0.0f) return;
+
+            glm::vec3 normal = normalMatrix * gradient;
+            float length = glm::length(normal);
+            if (length <= 0.0f) return;
+            points.push_back({glm::vec3(fieldMatrix * glm::vec4(p, 1.0f)), normal / length, -d / length});
+        };
+
+        for (const ConvexHull& hull : model.hulls) {
+            if (hull.points.empty()) continue;
+
+            glm::vec3 half = 0.5f * (hull.box.max_corner - hull.box.min_corner);
+            float radius = half.x * glm::length(glm::vec3(modelToField[0]))
+                         + half.y * glm::length(glm::vec3(modelToField[1]))
+                         + half.z * glm::length(glm::vec3(modelToField[2]));
+            glm::vec3 center = glm::vec3(modelToField * glm::vec4(hull.center(), 1.0f));
+            float clearance = field.distance(center);
+            if (field.solidOutside)
+                clearance = glm::min(clearance, field.boundaryDistance(center));
+            if (clearance > radius + margin) continue;
+
+            for (const glm::vec3& p : hull.points)
+                sample(glm::vec3(modelToField * glm::vec4(p, 1.0f)));
+        }
+
+        if (model.hulls.empty()) {
+            AABB box = model.getWorldAABB();
+            for (int corner = 0; corner < 8; corner++)
+                sample(glm::vec3(toField * glm::vec4(corner & 1 ? box.max_corner.x : box.min_corner.x,
+                                                     corner & 2 ? box.max_corner.y : box.min_corner.y,
+                                                     corner & 4 ? box.max_corner.z : box.min_corner.z, 1.0f)));
+        }
+        if (points.empty()) continue;
+
+        // cada grupo pela normal do primeiro ponto; sem grupo livre, o mais parecido
+        int groupCount = 0;
+        for (const ContactPoint& point : points) {
+            int best = -1;
+            float bestDot = -FLT_MAX;
+            for (int g = 0; g < groupCount; g++) {
+                float d = glm::dot(groups[g][0].normal, point.normal);
+                if (d > bestDot) {
+                    bestDot = d;
+                    best = g;
+                }
+            }
+            if (bestDot <= SDF_NORMAL_GROUP && groupCount < SDF_MAX_GROUPS) {
+                best = groupCount++;
+                groups[best].clear();
+            }
+            groups[best].push_back(point);
+        }
+
+        for (int g = 0; g < groupCount; g++) {
+            SceneContact contact;
+            contact.model = i;
+            contact.manifold.reduce(groups[g]);
+            contacts.push_back(contact);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include "shaders.hpp"
+
+#define SHADOW_SIZE 2048
+#define SHADOW_UNIT 4
+
+// Shadow map da luz do teto com cache: a geometria estática é renderizada
+// em um depth map próprio só quando a luz se move; a cada frame esse depth
+// é copiado para o mapa final e apenas os modelos dinâmicos são desenhados por cima.
+struct ShadowMap {
+    Shader depthShader;
+
+    GLuint staticFBO = 0, staticDepth = 0;
+    GLuint dynamicFBO = 0, dynamicDepth = 0;
+
+    glm::mat4 lightSpace = glm::mat4(1.0f);
+    glm::vec3 cachedLightPosition = glm::vec3(0.0f);
+    bool staticDirty = true;
+
+    // framebuffer/viewport ativos antes do passe de sombra
+    GLint savedFramebuffer = 0;
+    GLint savedViewport[4] = {0, 0, 0, 0};
+    bool targetSaved = false;
+
+    float fov = 110.0f;
+    float nearPlane = 1.0f;
+    float farPlane = 200.0f;
+
+    ShadowMap();
+
+    void init();
+    void invalidate() { staticDirty = true; }
+
+    // retorna true se a geometria estática precisa ser redesenhada neste frame
+    bool beginStaticPass(const glm::vec3& lightPosition);
+    void beginDynamicPass();
+    void endPass();
+
+    void bind(const Shader& s) const;
+    void destroy();
+
+private:
+    GLuint createDepthTarget(GLuint& texture);
+    void saveTarget();
+};
+
+ShadowMap::ShadowMap(): depthShader("shaders/shadow.vs.shader", "shaders/shadow.fs.shader") {}
+
+GLuint ShadowMap::createDepthTarget(GLuint& texture) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_SIZE, SHADOW_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float border[] = {1.0f, 1.0f, 1.0f, 1.0f};  // fora do mapa = iluminado
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Erro: framebuffer do shadow map incompleto" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return fbo;
+}
+
+void ShadowMap::init() {
+    staticFBO = createDepthTarget(staticDepth);
+    dynamicFBO = createDepthTarget(dynamicDepth);
+}
+
+bool ShadowMap::beginStaticPass(const glm::vec3& lightPosition) {
+    if (!staticDirty && lightPosition == cachedLightPosition)
+        return false;
+
+    // luz de teto apontando para baixo
+    glm::mat4 lightProjection = glm::perspective(glm::radians(fov), 1.0f, nearPlane, farPlane);
+    glm::mat4 lightView = glm::lookAt(lightPosition, lightPosition + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    lightSpace = lightProjection * lightView;
+
+    cachedLightPosition = lightPosition;
+    staticDirty = false;
+
+    saveTarget();
+    glViewport(0, 0, SHADOW_SIZE, SHADOW_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    depthShader.use();
+    depthShader.setMat4("lightSpaceMatrix", glm::value_ptr(lightSpace));
+    return true;
+}
+
+void ShadowMap::saveTarget() {
+    if (targetSaved) return;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    targetSaved = true;
+}
+
+void ShadowMap::beginDynamicPass() {
+    saveTarget();
+
+    // copia o depth estático em cache e desenha só os dinâmicos por cima
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dynamicFBO);
+    glBlitFramebuffer(0, 0, SHADOW_SIZE, SHADOW_SIZE, 0, 0, SHADOW_SIZE, SHADOW_SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glViewport(0, 0, SHADOW_SIZE, SHADOW_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, dynamicFBO);
+
+    depthShader.use();
+    depthShader.setMat4("lightSpaceMatrix", glm::value_ptr(lightSpace));
+}
+
+void ShadowMap::endPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, savedFramebuffer);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    targetSaved = false;
+}
+
+void ShadowMap::bind(const Shader& s) const {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_UNIT);
+    glBindTexture(GL_TEXTURE_2D, dynamicDepth);
+    glActiveTexture(GL_TEXTURE0);
+
+    s.setBool("useShadows", true);
+    s.setInt("shadowMap", SHADOW_UNIT);
+    s.setMat4("lightSpaceMatrix", glm::value_ptr(lightSpace));
+}
+
+void ShadowMap::destroy() {
+    glDeleteFramebuffers(1, &staticFBO);
+    glDeleteFramebuffers(1, &dynamicFBO);
+    glDeleteTextures(1, &staticDepth);
+    glDeleteTextures(1, &dynamicDepth);
+    glDeleteProgram(depthShader.ID);
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include "collision.hpp"
+#include "sdf.hpp"
+
+#define SOLVER_ITERATIONS 8
+#define SOLVER_FRICTION 0.5f          // coeficiente de atrito de Coulomb entre corpos
+#define SOLVER_BOUNCE_SPEED 5.0f      // abaixo dessa velocidade de aproximação não há quique
+#define SOLVER_SLOP 0.05f             // penetração tolerada, evita que o contato pisque
+#define SOLVER_POSITION_FACTOR 0.8f   // fração do excesso de penetração corrigida por passo
+#define SOLVER_MATCH_DISTANCE 0.5f    // distância (referencial de A) para casar pontos entre passos
+
+// Impulsos sequenciais: junta os contatos de todos os pares do passo e faz
+// iterations passadas sobre eles, cada ponto com o impulso normal acumulado
+// (nunca puxa) e dois de atrito limitados pelo cone de Coulomb. Os impulsos
+// de contatos que persistem são guardados por par e aplicados no início do
+// passo seguinte (warm start), o de atrito como vetor no mundo projetado na
+// base tangente nova. Depois das velocidades, a penetração que passou de
+// SOLVER_SLOP é corrigida na posição, dividida pelo inverso das massas.
+// Os contatos com a cena entram contra um corpo parado de massa infinita.
+struct ContactSolver {
+    int iterations = SOLVER_ITERATIONS;
+    bool warmStart = true;
+
+    int points = 0;        // pontos de contato no último passo
+    int warmStarted = 0;   // desses, quantos vieram do cache
+    long totalPoints = 0;
+    long totalWarmStarted = 0;
+
+    double warmStartRate() const { return totalPoints > 0 ? (double)totalWarmStarted / totalPoints : 0.0; }
+
+    void solve(std::vector<Model>& models, const std::vector<BroadphasePair>& pairs, const std::vector<PairContact>& contacts, const std::vector<SceneContact>& sceneContacts = {});
+
+private:
+    // Cópia de trabalho de um corpo; omega em radianos por segundo
+    struct Body {
+        int model;  // -1 para a cena
+        glm::vec3 velocity;
+        glm::vec3 omega;
+        glm::mat3 inverseInertia;  // no mundo
+        float inverseMass;
+        glm::vec3 center;
+    };
+
+    struct Point {
+        glm::vec3 rA, rB;
+        glm::vec3 localA;  // ponto no referencial de A, sem escala
+        float normalMass;
+        float tangentMass[2];
+        float bounce;      // velocidade de separação alvo
+        float normalImpulse = 0.0f;
+        float tangentImpulse[2] = {0.0f, 0.0f};
+    };
+
+    struct Contact {
+        int a, b;  // índices em bodies
+        glm::vec3 normal;  // de B para A
+        glm::vec3 tangent[2];
+        float depth;
+        Point points[MANIFOLD_MAX_POINTS];
+        int count;
+    };
+
+    struct CachedPoint {
+        glm::vec3 localA;
+        float normalImpulse;
+        glm::vec3 friction;  // impulso de atrito no mundo: a base tangente muda entre passos
+    };
+
+    struct CachedManifold {
+        CachedPoint points[MANIFOLD_MAX_POINTS];
+        int count = 0;
+        bool touched = false;
+    };
+
+    std::vector<Body> bodies;
+    std::vector<int> bodySlot;  // por modelo; -1 fora do passo
+    int sceneSlot = -1;
+    std::vector<Contact> solverContacts;
+    // (A, B, direção): B nulo e a direção da normal para a cena, -1 entre corpos
+    std::map<std::tuple<const Model*, const Model*, int>, CachedManifold> cache;
+
+    int addBody(std::vector<Model>& models, int index);
+    void addContact(std::vector<Model>& models, int a, int b, const ContactManifold& manifold);
+    void applyImpulse(const Contact& contact, const Point& point, const glm::vec3& impulse);
+    void solveContact(Contact& contact);
+    void storeImpulses(const std::vector<Model>& models);
+    void correctPositions(std::vector<Model>& models);
+};
+
+// Base do plano tangente a partir da normal
+static void contactTangents(const glm::vec3& normal, glm::vec3* tangent) {
+    glm::vec3 axis = glm::abs(normal.x) < 0.57f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    tangent[0] = glm::normalize(glm::cross(normal, axis));
+    tangent[1] = glm::cross(normal, tangent[0]);
+}
+
+// Eixo dominante da normal com sinal (0 a 5): um corpo tem um contato com a
+// cena por grupo de normais, e o chão e a parede não dividem a mesma entrada
+static int normalDirection(const glm::vec3& normal) {
+    glm::vec3 a = glm::abs(normal);
+    int axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+    return axis * 2 + (normal[axis] < 0.0f);
+}
+
+// Ponto no referencial do modelo: sem escala, para continuar válido enquanto
+// o corpo gira e anda
+static glm::vec3 contactLocalPoint(const Model& model, const glm::vec3& point) {
+    return glm::conjugate(model.transforms.orientation) * (point - model.transforms.position);
+}
+
+// Cada modelo entra uma vez por passo; o contato acorda quem dormia. index
+// -1 é a cena: parada, sem massa nem inércia inversas.
+int ContactSolver::addBody(std::vector<Model>& models, int index) {
+    if (index < 0) {
+        if (sceneSlot < 0) {
+            bodies.push_back({-1, glm::vec3(0.0f), glm::vec3(0.0f), glm::mat3(0.0f), 0.0f, glm::vec3(0.0f)});
+            sceneSlot = (int)bodies.size() - 1;
+        }
+        return sceneSlot;
+    }
+    if (bodySlot[index] >= 0) return bodySlot[index];
+
+    Model& model = models[index];
+    model.body.wake();
+
+    Body body;
+    body.model = index;
+    body.velocity = model.body.velocity();
+    body.omega = glm::radians(model.body.angularVelocity());
+    body.inverseInertia = bodyInverseInertia(model);
+    body.inverseMass = model.body.inverseMass();
+    body.center = model.getCenterOfMass();
+    bodies.push_back(body);
+
+    bodySlot[index] = (int)bodies.size() - 1;
+    return bodySlot[index];
+}
+
+// Massas efetivas, quique e impulsos do passo anterior de cada ponto. Sem
+// pontos (modo caixa) o contato vira um ponto nos centros, sem torque.
+void ContactSolver::addContact(std::vector<Model>& models, int a, int b, const ContactManifold& manifold) {
+    Contact contact;
+    contact.a = addBody(models, a);
+    contact.b = addBody(models, b);
+    contact.normal = manifold.normal;
+    contactTangents(contact.normal, contact.tangent);
+    contact.depth = manifold.depth;
+    contact.count = manifold.count > 0 ? manifold.count : 1;
+
+    const Body& bodyA = bodies[contact.a];
+    const Body& bodyB = bodies[contact.b];
+    const CachedManifold* cached = nullptr;
+    if (warmStart) {
+        auto it = cache.find({&models[a], b >= 0 ? &models[b] : nullptr, b >= 0 ? -1 : normalDirection(contact.normal)});
+        if (it != cache.end()) cached = &it->second;
+    }
+    bool used[MANIFOLD_MAX_POINTS] = {};
+
+    for (int i = 0; i < contact.count; i++) {
+        Point& point = contact.points[i];
+        glm::vec3 position = manifold.count > 0 ? manifold.points[i].position : bodyA.center;
+        point.rA = manifold.count > 0 ? position - bodyA.center : glm::vec3(0.0f);
+        point.rB = manifold.count > 0 ? position - bodyB.center : glm::vec3(0.0f);
+        point.localA = contactLocalPoint(models[a], position);
+
+        auto effectiveMass = [&](const glm::vec3& direction) {
+            glm::vec3 rnA = glm::cross(point.rA, direction);
+            glm::vec3 rnB = glm::cross(point.rB, direction);
+            float k = bodyA.inverseMass + bodyB.inverseMass + glm::dot(rnA, bodyA.inverseInertia * rnA) + glm::dot(rnB, bodyB.inverseInertia * rnB);
+            return k > 0.0f ? 1.0f / k : 0.0f;
+        };
+        point.normalMass = effectiveMass(contact.normal);
+        point.tangentMass[0] = effectiveMass(contact.tangent[0]);
+        point.tangentMass[1] = effectiveMass(contact.tangent[1]);
+
+        glm::vec3 relativeVelocity = (bodyA.velocity + glm::cross(bodyA.omega, point.rA)) - (bodyB.velocity + glm::cross(bodyB.omega, point.rB));
+        float approach = glm::dot(relativeVelocity, contact.normal);
+        point.bounce = approach < -SOLVER_BOUNCE_SPEED ? -RESTITUTION * approach : 0.0f;
+
+        if (!cached) continue;
+        // o mais perto ainda livre: cada ponto antigo passa o impulso uma vez só
+        int match = -1;
+        float matchDistance = SOLVER_MATCH_DISTANCE;
+        for (int j = 0; j < cached->count; j++) {
+            float distance = glm::distance(cached->points[j].localA, point.localA);
+            if (used[j] || distance > matchDistance) continue;
+            match = j;
+            matchDistance = distance;
+        }
+        if (match < 0) continue;
+
+        const CachedPoint& old = cached->points[match];
+        used[match] = true;
+        point.normalImpulse = old.normalImpulse;
+        point.tangentImpulse[0] = glm::dot(old.friction, contact.tangent[0]);
+        point.tangentImpulse[1] = glm::dot(old.friction, contact.tangent[1]);
+        warmStarted++;
+    }
+    points += contact.count;
+    solverContacts.push_back(contact);
+}
+
+void ContactSolver::applyImpulse(const Contact& contact, const Point& point, const glm::vec3& impulse) {
+    Body& bodyA = bodies[contact.a];
+    Body& bodyB = bodies[contact.b];
+    bodyA.velocity += impulse * bodyA.inverseMass;
+    bodyA.omega += bodyA.inverseInertia * glm::cross(point.rA, impulse);
+    bodyB.velocity -= impulse * bodyB.inverseMass;
+    bodyB.omega -= bodyB.inverseInertia * glm::cross(point.rB, impulse);
+}
+
+// Uma passada: atrito limitado pelo impulso normal acumulado, depois a normal
+// limitada a empurrar. Os limites valem para o acumulado, não para o delta.
+void ContactSolver::solveContact(Contact& contact) {
+    for (int i = 0; i < contact.count; i++) {
+        Point& point = contact.points[i];
+        auto relativeVelocity = [&]() {
+            const Body& bodyA = bodies[contact.a];
+            const Body& bodyB = bodies[contact.b];
+            return (bodyA.velocity + glm::cross(bodyA.omega, point.rA)) - (bodyB.velocity + glm::cross(bodyB.omega, point.rB));
+        };
+
+        float maxFriction = SOLVER_FRICTION * point.normalImpulse;
+        for (int k = 0; k < 2; k++) {
+            float lambda = -glm::dot(relativeVelocity(), contact.tangent[k]) * point.tangentMass[k];
+            float previous = point.tangentImpulse[k];
+            point.tangentImpulse[k] = glm::clamp(previous + lambda, -maxFriction, maxFriction);
+            applyImpulse(contact, point, contact.tangent[k] * (point.tangentImpulse[k] - previous));
+        }
+
+        float lambda = (point.bounce - glm::dot(relativeVelocity(), contact.normal)) * point.normalMass;
+        float previous = point.normalImpulse;
+        point.normalImpulse = glm::max(previous + lambda, 0.0f);
+        applyImpulse(contact, point, contact.normal * (point.normalImpulse - previous));
+    }
+}
+
+// Guarda os impulsos finais por par; pares sem contato neste passo saem
+void ContactSolver::storeImpulses(const std::vector<Model>& models) {
+    for (const Contact& contact : solverContacts) {
+        int b = bodies[contact.b].model;
+        CachedManifold& cached = cache[{&models[bodies[contact.a].model], b >= 0 ? &models[b] : nullptr, b >= 0 ? -1 : normalDirection(contact.normal)}];
+        cached.count = contact.count;
+        cached.touched = true;
+        for (int i = 0; i < contact.count; i++) {
+            cached.points[i].localA = contact.points[i].localA;
+            cached.points[i].normalImpulse = contact.points[i].normalImpulse;
+            cached.points[i].friction = contact.tangent[0] * contact.points[i].tangentImpulse[0]
+                                      + contact.tangent[1] * contact.points[i].tangentImpulse[1];
+        }
+    }
+
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (!it->second.touched) {
+            it = cache.erase(it);
+        } else {
+            it->second.touched = false;
+            ++it;
+        }
+    }
+}
+
+// Só o excesso sobre SOLVER_SLOP, e só uma fração: a folga mantém o contato
+// vivo entre passos, que é o que deixa o warm start casar os pontos
+void ContactSolver::correctPositions(std::vector<Model>& models) {
+    for (const Contact& contact : solverContacts) {
+        const Body& bodyA = bodies[contact.a];
+        const Body& bodyB = bodies[contact.b];
+        float inverseMass = bodyA.inverseMass + bodyB.inverseMass;
+        float excess = contact.depth - SOLVER_SLOP;
+        if (excess <= 0.0f || inverseMass <= 0.0f) continue;
+
+        glm::vec3 correction = contact.normal * (SOLVER_POSITION_FACTOR * excess / inverseMass);
+        models[bodyA.model].translate(correction * bodyA.inverseMass);
+        if (bodyB.model >= 0)
+            models[bodyB.model].translate(-correction * bodyB.inverseMass);
+    }
+}
+
+// contacts em ordem de par, como ParallelNarrowphase::contacts(): o resultado
+// não depende de quantas threads detectaram
+void ContactSolver::solve(std::vector<Model>& models, const std::vector<BroadphasePair>& pairs, const std::vector<PairContact>& contacts, const std::vector<SceneContact>& sceneContacts) {
+    PROFILE_FUNCTION();
+
+    bodies.clear();
+    bodySlot.assign(models.size(), -1);
+    sceneSlot = -1;
+    solverContacts.clear();
+    points = 0;
+    warmStarted = 0;
+
+    for (const PairContact& contact : contacts) {
+        const BroadphasePair& pair = pairs[contact.pair];
+        addContact(models, pair.a, pair.b, contact.manifold);
+    }
+    for (const SceneContact& contact : sceneContacts)
+        addContact(models, contact.model, -1, contact.manifold);
+
+    if (warmStart)
+        for (const Contact& contact : solverContacts)
+            for (int i = 0; i < contact.count; i++) {
+                const Point& point = contact.points[i];
+                applyImpulse(contact, point, contact.normal * point.normalImpulse
+                                             + contact.tangent[0] * point.tangentImpulse[0]
+                                             + contact.tangent[1] * point.tangentImpulse[1]);
+            }
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+        for (Contact& contact : solverContacts)
+            solveContact(contact);
+
+    for (const Body& body : bodies) {
+        if (body.model < 0) continue;
+        models[body.model].body.setVelocity(body.velocity);
+        models[body.model].body.setAngularVelocity(glm::degrees(body.omega));
+    }
+
+    storeImpulses(models);
+    correctPositions(models);
+
+    totalPoints += points;
+    totalWarmStarted += warmStarted;
+}
+
+#endif
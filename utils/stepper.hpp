@@ -0,0 +1,55 @@
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include <cmath>
+
+#define PHYSICS_DEFAULT_RATE 120.0f
+#define PHYSICS_MAX_SUBSTEPS 8
+#define PHYSICS_REFERENCE_RATE 60.0f  // taxa em que os coeficientes por passo foram ajustados
+
+// Passo fixo com acumulador: o tempo de cada frame entra no acumulador e sai
+// em passos de 1/rate. O resto vira alpha, a fração do próximo passo usada
+// para interpolar o desenho entre os dois últimos estados da física.
+struct FixedStepper {
+    double step = 1.0 / PHYSICS_DEFAULT_RATE;
+    int maxSubSteps = PHYSICS_MAX_SUBSTEPS;
+    double accumulator = 0.0;
+    double time = 0.0;           // tempo simulado
+    long droppedFrames = 0;      // frames que bateram no limite de passos
+
+    bool setRate(float hz);
+    float rate() const { return (float)(1.0 / step); }
+    int advance(double frameTime);
+    float alpha() const { return (float)(accumulator / step); }
+    float perStep(float perReferenceFrame) const;
+};
+
+bool FixedStepper::setRate(float hz) {
+    if (!(hz > 0.0f)) return false;
+    step = 1.0 / hz;
+    accumulator = 0.0;
+    return true;
+}
+
+// Quantos passos rodar neste frame. Acima do limite o tempo excedente é
+// descartado (a simulação fica mais lenta em vez de entrar em espiral).
+int FixedStepper::advance(double frameTime) {
+    accumulator += frameTime > 0.0 ? frameTime : 0.0;
+
+    int steps = (int)(accumulator / step);
+    if (steps > maxSubSteps) {
+        steps = maxSubSteps;
+        accumulator = std::fmod(accumulator, step);
+        droppedFrames++;
+    } else {
+        accumulator -= steps * step;
+    }
+    return steps;
+}
+
+// Fator multiplicativo ajustado a 60 Hz (amortecimentos) convertido para um passo
+float FixedStepper::perStep(float perReferenceFrame) const {
+    return std::pow(perReferenceFrame, (float)(step * PHYSICS_REFERENCE_RATE));
+}
+
+#endif
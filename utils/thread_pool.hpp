@@ -0,0 +1,151 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profiler.hpp"
+
+// Pool com uma fila por worker: parallelFor reparte os índices em blocos
+// contíguos, cada worker consome a própria fila pela frente e, quando ela
+// esvazia, rouba pelo fundo das filas dos outros. A thread que chama
+// parallelFor trabalha como worker 0, então size() == 1 não cria threads.
+struct WorkStealingPool {
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    int size() const { return (int)queues.size(); }
+    void parallelFor(int count, const std::function<void(int index, int worker)>& task);
+
+    long steals = 0;  // acumulado; só lido entre chamadas de parallelFor
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> items;
+        long steals = 0;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int, int)>* job = nullptr;
+    long generation = 0;
+    int running = 0;   // workers ainda dentro do job atual
+    bool quit = false;
+
+    bool pop(int worker, int& index);
+    bool steal(int worker, int& index);
+    void runJob(int worker);
+    void workerLoop(int worker);
+};
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    threads = std::max(threads, 1);
+    for (int i = 0; i < threads; i++)
+        queues.push_back(std::make_unique<Queue>());
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+bool WorkStealingPool::pop(int worker, int& index) {
+    Queue& queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) return false;
+    index = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+// Rouba do fundo, onde estão os índices que o dono pegaria por último
+bool WorkStealingPool::steal(int worker, int& index) {
+    for (int offset = 1; offset < size(); offset++) {
+        Queue& victim = *queues[(worker + offset) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.items.empty()) continue;
+        index = victim.items.back();
+        victim.items.pop_back();
+        queues[worker]->steals++;
+        return true;
+    }
+    return false;
+}
+
+// Nenhum índice novo aparece durante o job: filas vazias significam fim
+void WorkStealingPool::runJob(int worker) {
+    int index;
+    while (pop(worker, index) || steal(worker, index))
+        (*job)(index, worker);
+}
+
+void WorkStealingPool::parallelFor(int count, const std::function<void(int index, int worker)>& task) {
+    if (count <= 0) return;
+
+    int threads = size();
+    for (int w = 0; w < threads; w++) {
+        Queue& queue = *queues[w];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (int i = count * w / threads; i < count * (w + 1) / threads; i++)
+            queue.items.push_back(i);
+    }
+
+    job = &task;
+    if (threads > 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = threads - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    runJob(0);
+
+    if (threads > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return running == 0; });
+    }
+    job = nullptr;
+
+    for (const std::unique_ptr<Queue>& queue : queues) {
+        steals += queue->steals;
+        queue->steals = 0;
+    }
+}
+
+void WorkStealingPool::workerLoop(int worker) {
+    Profiler::instance().setThreadName("pool " + std::to_string(worker));
+
+    long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return quit || generation != seen; });
+        if (quit) break;
+        seen = generation;
+
+        lock.unlock();
+        runJob(worker);
+        lock.lock();
+
+        if (--running == 0)
+            finished.notify_one();
+    }
+}
+
+#endif
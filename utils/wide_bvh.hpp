@@ -0,0 +1,431 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cfloat>
+#include "bvh.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define WIDE_BVH_X86
+    #include <immintrin.h>
+#endif
+
+#define WIDE_BVH_EMPTY 0xFFFFFFFFu
+#define WIDE_BVH_STACK_SIZE 1024   // (W + 1) * (2 * BVH_MAX_DEPTH) + 1 entradas no pior caso com W = 8
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE,
+    SIMD_AVX2
+};
+
+// Detectado uma vez em tempo de execução: o binário não exige AVX2
+SimdLevel detectSimdLevel() {
+#ifdef WIDE_BVH_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2
+                                 : __builtin_cpu_supports("sse2") ? SIMD_SSE
+                                 : SIMD_SCALAR;
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE: return "sse";
+        default: return "escalar";
+    }
+}
+
+// Conjunto de instruções que os nós de W filhos usam nesta CPU
+SimdLevel wideBVHKernel(int width) {
+    SimdLevel level = detectSimdLevel();
+    if (width == 8) return level == SIMD_AVX2 ? SIMD_AVX2 : SIMD_SCALAR;
+    return level >= SIMD_SSE ? SIMD_SSE : SIMD_SCALAR;
+}
+
+// Largura da BVH usada pela narrowphase e pelos raios; 2 = árvore binária
+bool parseBVHWidth(const std::string& name, int& width) {
+    if (name == "2") width = 2;
+    else if (name == "4") width = 4;
+    else if (name == "8") width = 8;
+    else if (name == "auto") width = detectSimdLevel() == SIMD_AVX2 ? 8 : 4;
+    else return false;
+    return true;
+}
+
+// Nó com W filhos e os limites deles em SoA: uma sequência de instruções
+// testa a consulta contra todos os filhos. Filhos vazios ficam no fim, com
+// caixa invertida (nunca sobrepõe) e child = WIDE_BVH_EMPTY.
+template<int W>
+struct alignas(32) WideBVHNode {
+    float minX[W], minY[W], minZ[W];
+    float maxX[W], maxY[W], maxZ[W];
+    GLuint child[W];   // interno: índice do nó largo; folha: primeiro triângulo
+    GLuint count[W];   // triângulos da folha; 0 = interno
+
+    bool isEmpty(int i) const { return child[i] == WIDE_BVH_EMPTY; }
+    bool isLeaf(int i) const { return count[i] > 0; }
+    AABB box(int i) const { return AABB{glm::vec3(minX[i], minY[i], minZ[i]), glm::vec3(maxX[i], maxY[i], maxZ[i])}; }
+};
+
+template<int W>
+int overlapMaskScalar(const WideBVHNode<W>& node, const AABB& box) {
+    int mask = 0;
+    for (int i = 0; i < W; i++) {
+        if (node.minX[i] <= box.max_corner.x && node.maxX[i] >= box.min_corner.x &&
+            node.minY[i] <= box.max_corner.y && node.maxY[i] >= box.min_corner.y &&
+            node.minZ[i] <= box.max_corner.z && node.maxZ[i] >= box.min_corner.z)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+// Mesmo teste de slabs de rayIntersectsAABB para cada filho
+template<int W>
+int rayMaskScalar(const WideBVHNode<W>& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, float* tEntry) {
+    int mask = 0;
+    for (int i = 0; i < W; i++) {
+        if (rayIntersectsAABB(origin, invDir, maxDistance, node.box(i), tEntry[i]))
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+// Eixos de face do SAT (3 de A, 3 de B) entre cada filho e um nó de B já
+// expresso no espaço de A: bCenter/bRadius vêm de relative, bHalf é a meia
+// extensão local de B. Sem os 9 eixos de aresta o teste é conservador.
+template<int W>
+int obbOverlapMaskScalar(const WideBVHNode<W>& node, const RelativeTransform& relative, const glm::vec3& bCenter, const glm::vec3& bRadius, const glm::vec3& bHalf) {
+    int mask = 0;
+    for (int i = 0; i < W; i++) {
+        AABB box = node.box(i);
+        glm::vec3 aHalf = (box.max_corner - box.min_corner) * 0.5f;
+        glm::vec3 d = bCenter - (box.min_corner + box.max_corner) * 0.5f;
+
+        bool hit = std::abs(d.x) <= aHalf.x + bRadius.x && std::abs(d.y) <= aHalf.y + bRadius.y && std::abs(d.z) <= aHalf.z + bRadius.z;
+        glm::vec3 tB = relative.inverse * d;
+        glm::vec3 aRadius = relative.absInverse * aHalf;
+        hit = hit && std::abs(tB.x) <= aRadius.x + bHalf.x && std::abs(tB.y) <= aRadius.y + bHalf.y && std::abs(tB.z) <= aRadius.z + bHalf.z;
+
+        if (hit) mask |= 1 << i;
+    }
+    return mask;
+}
+
+#ifdef WIDE_BVH_X86
+int overlapMaskSse(const WideBVHNode<4>& node, const AABB& box) {
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(box.max_corner.x)),
+                            _mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(box.min_corner.x)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(box.max_corner.y)),
+                                     _mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(box.min_corner.y))));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minZ), _mm_set1_ps(box.max_corner.z)),
+                                     _mm_cmpge_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(box.min_corner.z))));
+    return _mm_movemask_ps(hit);
+}
+
+int rayMaskSse(const WideBVHNode<4>& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, float* tEntry) {
+    __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), _mm_set1_ps(origin.x)), _mm_set1_ps(invDir.x));
+    __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), _mm_set1_ps(origin.x)), _mm_set1_ps(invDir.x));
+    __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), _mm_set1_ps(origin.y)), _mm_set1_ps(invDir.y));
+    __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), _mm_set1_ps(origin.y)), _mm_set1_ps(invDir.y));
+    __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), _mm_set1_ps(origin.z)), _mm_set1_ps(invDir.z));
+    __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(origin.z)), _mm_set1_ps(invDir.z));
+
+    __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+                              _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+    __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+                             _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(maxDistance)));
+
+    _mm_storeu_ps(tEntry, enter);
+    return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+}
+
+int obbOverlapMaskSse(const WideBVHNode<4>& node, const RelativeTransform& relative, const glm::vec3& bCenter, const glm::vec3& bRadius, const glm::vec3& bHalf) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 minX = _mm_load_ps(node.minX), maxX = _mm_load_ps(node.maxX);
+    __m128 minY = _mm_load_ps(node.minY), maxY = _mm_load_ps(node.maxY);
+    __m128 minZ = _mm_load_ps(node.minZ), maxZ = _mm_load_ps(node.maxZ);
+
+    __m128 hx = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+    __m128 hy = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+    __m128 hz = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+    __m128 dx = _mm_sub_ps(_mm_set1_ps(bCenter.x), _mm_mul_ps(_mm_add_ps(minX, maxX), half));
+    __m128 dy = _mm_sub_ps(_mm_set1_ps(bCenter.y), _mm_mul_ps(_mm_add_ps(minY, maxY), half));
+    __m128 dz = _mm_sub_ps(_mm_set1_ps(bCenter.z), _mm_mul_ps(_mm_add_ps(minZ, maxZ), half));
+
+    // faces de A
+    __m128 hit = _mm_cmple_ps(_mm_andnot_ps(sign, dx), _mm_add_ps(hx, _mm_set1_ps(bRadius.x)));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_andnot_ps(sign, dy), _mm_add_ps(hy, _mm_set1_ps(bRadius.y))));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_andnot_ps(sign, dz), _mm_add_ps(hz, _mm_set1_ps(bRadius.z))));
+
+    // faces de B: linha j de inverse e de absInverse
+    for (int j = 0; j < 3; j++) {
+        __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(relative.inverse[0][j])),
+                                         _mm_mul_ps(dy, _mm_set1_ps(relative.inverse[1][j]))),
+                              _mm_mul_ps(dz, _mm_set1_ps(relative.inverse[2][j])));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, _mm_set1_ps(relative.absInverse[0][j])),
+                                         _mm_mul_ps(hy, _mm_set1_ps(relative.absInverse[1][j]))),
+                              _mm_mul_ps(hz, _mm_set1_ps(relative.absInverse[2][j])));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_andnot_ps(sign, t), _mm_add_ps(r, _mm_set1_ps(bHalf[j]))));
+    }
+
+    return _mm_movemask_ps(hit);
+}
+
+__attribute__((target("avx2,fma")))
+int overlapMaskAvx2(const WideBVHNode<8>& node, const AABB& box) {
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minX), _mm256_set1_ps(box.max_corner.x), _CMP_LE_OQ),
+                               _mm256_cmp_ps(_mm256_load_ps(node.maxX), _mm256_set1_ps(box.min_corner.x), _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minY), _mm256_set1_ps(box.max_corner.y), _CMP_LE_OQ),
+                                           _mm256_cmp_ps(_mm256_load_ps(node.maxY), _mm256_set1_ps(box.min_corner.y), _CMP_GE_OQ)));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(node.minZ), _mm256_set1_ps(box.max_corner.z), _CMP_LE_OQ),
+                                           _mm256_cmp_ps(_mm256_load_ps(node.maxZ), _mm256_set1_ps(box.min_corner.z), _CMP_GE_OQ)));
+    return _mm256_movemask_ps(hit);
+}
+
+__attribute__((target("avx2,fma")))
+int rayMaskAvx2(const WideBVHNode<8>& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, float* tEntry) {
+    __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minX), _mm256_set1_ps(origin.x)), _mm256_set1_ps(invDir.x));
+    __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxX), _mm256_set1_ps(origin.x)), _mm256_set1_ps(invDir.x));
+    __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minY), _mm256_set1_ps(origin.y)), _mm256_set1_ps(invDir.y));
+    __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxY), _mm256_set1_ps(origin.y)), _mm256_set1_ps(invDir.y));
+    __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minZ), _mm256_set1_ps(origin.z)), _mm256_set1_ps(invDir.z));
+    __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxZ), _mm256_set1_ps(origin.z)), _mm256_set1_ps(invDir.z));
+
+    __m256 enter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)),
+                                 _mm256_max_ps(_mm256_min_ps(t0z, t1z), _mm256_setzero_ps()));
+    __m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)),
+                                _mm256_min_ps(_mm256_max_ps(t0z, t1z), _mm256_set1_ps(maxDistance)));
+
+    _mm256_storeu_ps(tEntry, enter);
+    return _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+}
+__attribute__((target("avx2,fma")))
+int obbOverlapMaskAvx2(const WideBVHNode<8>& node, const RelativeTransform& relative, const glm::vec3& bCenter, const glm::vec3& bRadius, const glm::vec3& bHalf) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 minX = _mm256_load_ps(node.minX), maxX = _mm256_load_ps(node.maxX);
+    __m256 minY = _mm256_load_ps(node.minY), maxY = _mm256_load_ps(node.maxY);
+    __m256 minZ = _mm256_load_ps(node.minZ), maxZ = _mm256_load_ps(node.maxZ);
+
+    __m256 hx = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+    __m256 hy = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+    __m256 hz = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+    __m256 dx = _mm256_sub_ps(_mm256_set1_ps(bCenter.x), _mm256_mul_ps(_mm256_add_ps(minX, maxX), half));
+    __m256 dy = _mm256_sub_ps(_mm256_set1_ps(bCenter.y), _mm256_mul_ps(_mm256_add_ps(minY, maxY), half));
+    __m256 dz = _mm256_sub_ps(_mm256_set1_ps(bCenter.z), _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half));
+
+    // faces de A
+    __m256 hit = _mm256_cmp_ps(_mm256_andnot_ps(sign, dx), _mm256_add_ps(hx, _mm256_set1_ps(bRadius.x)), _CMP_LE_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_andnot_ps(sign, dy), _mm256_add_ps(hy, _mm256_set1_ps(bRadius.y)), _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_andnot_ps(sign, dz), _mm256_add_ps(hz, _mm256_set1_ps(bRadius.z)), _CMP_LE_OQ));
+
+    // faces de B: linha j de inverse e de absInverse
+    for (int j = 0; j < 3; j++) {
+        __m256 t = _mm256_fmadd_ps(dz, _mm256_set1_ps(relative.inverse[2][j]),
+                   _mm256_fmadd_ps(dy, _mm256_set1_ps(relative.inverse[1][j]),
+                   _mm256_mul_ps(dx, _mm256_set1_ps(relative.inverse[0][j]))));
+        __m256 r = _mm256_fmadd_ps(hz, _mm256_set1_ps(relative.absInverse[2][j]),
+                   _mm256_fmadd_ps(hy, _mm256_set1_ps(relative.absInverse[1][j]),
+                   _mm256_mul_ps(hx, _mm256_set1_ps(relative.absInverse[0][j]))));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_andnot_ps(sign, t), _mm256_add_ps(r, _mm256_set1_ps(bHalf[j])), _CMP_LE_OQ));
+    }
+
+    return _mm256_movemask_ps(hit);
+}
+#endif
+
+// BVH de W filhos (4 = SSE, 8 = AVX2) montada colapsando a BVH binária:
+// cada nó largo absorve os descendentes internos de maior área até ter W filhos.
+template<int W>
+struct WideBVH {
+    static_assert(W == 4 || W == 8, "WideBVH suporta 4 ou 8 filhos");
+
+    std::vector<WideBVHNode<W>> nodes;
+    bool simd = wideBVHKernel(W) != SIMD_SCALAR;
+
+    void build(const std::vector<BVHNode>& binary);
+
+    int overlapMask(const WideBVHNode<W>& node, const AABB& box) const;
+    int obbOverlapMask(const WideBVHNode<W>& node, const RelativeTransform& relative, const glm::vec3& bCenter, const glm::vec3& bRadius, const glm::vec3& bHalf) const;
+    int rayMask(const WideBVHNode<W>& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, float* tEntry) const;
+
+    template<typename Callback>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& leaf) const;
+
+private:
+    GLuint collapse(const std::vector<BVHNode>& binary, GLuint root);
+};
+
+template<int W>
+void WideBVH<W>::build(const std::vector<BVHNode>& binary) {
+    nodes.clear();
+    if (binary.empty()) return;
+
+    // ~ (n - 1) / (W - 1) nós internos largos
+    nodes.reserve(binary.size() / (W - 1) + 1);
+    collapse(binary, 0);
+}
+
+template<int W>
+GLuint WideBVH<W>::collapse(const std::vector<BVHNode>& binary, GLuint root) {
+    GLuint slots[W];
+    int n = 0;
+
+    if (binary[root].isLeaf()) {
+        slots[n++] = root;
+    } else {
+        slots[n++] = root + 1;
+        slots[n++] = binary[root].offset;
+    }
+
+    // abre o filho interno de maior área até completar W
+    while (n < W) {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < n; i++) {
+            if (binary[slots[i]].isLeaf()) continue;
+            float area = aabbSurfaceArea(binary[slots[i]].box());
+            if (area > bestArea) {
+                bestArea = area;
+                best = i;
+            }
+        }
+        if (best < 0) break;
+
+        GLuint opened = slots[best];
+        slots[best] = opened + 1;
+        slots[n++] = binary[opened].offset;
+    }
+
+    GLuint index = (GLuint)nodes.size();
+    nodes.emplace_back();
+
+    for (int i = 0; i < W; i++) {
+        WideBVHNode<W>& node = nodes[index];
+        if (i >= n) {
+            node.minX[i] = node.minY[i] = node.minZ[i] = FLT_MAX;
+            node.maxX[i] = node.maxY[i] = node.maxZ[i] = -FLT_MAX;
+            node.child[i] = WIDE_BVH_EMPTY;
+            node.count[i] = 0;
+            continue;
+        }
+
+        const BVHNode& source = binary[slots[i]];
+        node.minX[i] = source.min_corner.x;
+        node.minY[i] = source.min_corner.y;
+        node.minZ[i] = source.min_corner.z;
+        node.maxX[i] = source.max_corner.x;
+        node.maxY[i] = source.max_corner.y;
+        node.maxZ[i] = source.max_corner.z;
+        node.count[i] = source.triangleCount;
+        node.child[i] = source.offset;
+
+        // a recursão pode realocar nodes: escreve pelo índice depois
+        if (!source.isLeaf()) {
+            GLuint child = collapse(binary, slots[i]);
+            nodes[index].child[i] = child;
+        }
+    }
+
+    return index;
+}
+
+template<int W>
+int WideBVH<W>::overlapMask(const WideBVHNode<W>& node, const AABB& box) const {
+#ifdef WIDE_BVH_X86
+    if (simd) {
+        if constexpr (W == 4) return overlapMaskSse(node, box);
+        else return overlapMaskAvx2(node, box);
+    }
+#endif
+    return overlapMaskScalar(node, box);
+}
+
+template<int W>
+int WideBVH<W>::obbOverlapMask(const WideBVHNode<W>& node, const RelativeTransform& relative, const glm::vec3& bCenter, const glm::vec3& bRadius, const glm::vec3& bHalf) const {
+#ifdef WIDE_BVH_X86
+    if (simd) {
+        if constexpr (W == 4) return obbOverlapMaskSse(node, relative, bCenter, bRadius, bHalf);
+        else return obbOverlapMaskAvx2(node, relative, bCenter, bRadius, bHalf);
+    }
+#endif
+    return obbOverlapMaskScalar(node, relative, bCenter, bRadius, bHalf);
+}
+
+template<int W>
+int WideBVH<W>::rayMask(const WideBVHNode<W>& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, float* tEntry) const {
+#ifdef WIDE_BVH_X86
+    if (simd) {
+        if constexpr (W == 4) return rayMaskSse(node, origin, invDir, maxDistance, tEntry);
+        else return rayMaskAvx2(node, origin, invDir, maxDistance, tEntry);
+    }
+#endif
+    return rayMaskScalar(node, origin, invDir, maxDistance, tEntry);
+}
+
+// Mesmo contrato de bvhRaycast; os filhos atingidos são visitados do mais próximo ao mais distante
+template<int W>
+template<typename Callback>
+void WideBVH<W>::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& leaf) const {
+    if (nodes.empty()) return;
+
+    struct Entry {
+        GLuint node;
+        float tEntry;
+    };
+
+    glm::vec3 invDir = 1.0f / direction;
+    Entry stack[WIDE_BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, 0.0f};
+
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.tEntry > maxDistance)
+            continue;
+
+        const WideBVHNode<W>& node = nodes[entry.node];
+        float tEntry[W];
+        int mask = rayMask(node, origin, invDir, maxDistance, tEntry);
+
+        // filhos atingidos em ordem decrescente de distância de entrada
+        int hits[W];
+        int hitCount = 0;
+        for (int i = 0; i < W; i++) {
+            if (!(mask & (1 << i)) || node.isEmpty(i)) continue;
+            int j = hitCount++;
+            while (j > 0 && tEntry[hits[j - 1]] < tEntry[i]) {
+                hits[j] = hits[j - 1];
+                j--;
+            }
+            hits[j] = i;
+        }
+
+        // internos empilhados do mais distante ao mais próximo: o próximo sai primeiro
+        for (int h = 0; h < hitCount; h++)
+            if (!node.isLeaf(hits[h]))
+                stack[top++] = {node.child[hits[h]], tEntry[hits[h]]};
+
+        // folhas mais próximas primeiro, já encurtando o raio
+        for (int h = hitCount - 1; h >= 0; h--) {
+            int i = hits[h];
+            if (!node.isLeaf(i) || tEntry[i] > maxDistance) continue;
+
+            float clipped = leaf(node.child[i], node.count[i]);
+            if (clipped <= 0.0f)
+                return;
+            maxDistance = std::min(maxDistance, clipped);
+        }
+    }
+}
+
+#endif